@@ -22,5 +22,7 @@ file.close()
 
 
 out = open("assets/sample.wordlist", "wb")
-out.write(b"".join([bytearray((word + '\0' * (32 - len(word))).encode("utf-8")) for word in words]))
+# Every word is terminated and padded to a multiple of 32 bytes, so long words take several records.
+encoded = [word.encode("utf-8") for word in words]
+out.write(b"".join([word + b'\0' * (32 - len(word) % 32) for word in encoded]))
 out.close()
@@ -10,3 +10,11 @@
  */
 
 #include "common_flags.h"
+
+{ {'B', ""}, { GET_WRAPPER(bucket_count), 1, edit_int },
+    "set initial number of buckets in the table (-B2027).\n"
+    "\tNon-power-of-two tables use prime bucket counts when they grow." },
+
+{ {'F', ""}, { GET_WRAPPER(hash_name), 1, edit_string },
+    "select tested hash function by its name (-Fcrc32_hash).\n"
+    "\t-Fall tests every function meant for the generated keys in a single run." },
@@ -6,6 +6,7 @@ section .text
 
 murmur_hash:
         mov rax, 0xBAADF00DDEADBEEF
+        mov r8d, 0xCADAB8A9
         cmp rdi, rsi
         lea r11, [r8 + 334931268]
         mov r9, 8027858709520580608
@@ -0,0 +1,518 @@
+/**
+ * @file atomic_table.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Open-addressing hash table with compare-and-swap insertion for parallel construction.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef ATOMIC_TABLE_HPP
+#define ATOMIC_TABLE_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "src/utils/config.h"
+
+#include "table_elem.h"
+#include "hash_bucket.hpp"
+#include "key_arena.hpp"
+
+//* Slot states. Full slots store 7 upper bits of the hash with the high bit set.
+static const ht_tag_t AT_EMPTY  = 0x00;
+static const ht_tag_t AT_BUSY   = 0x01;  //* the slot is claimed by an inserter which has not published its key yet
+static const ht_tag_t AT_ERASED = 0x02;
+static const ht_tag_t AT_FULL   = 0x80;
+
+//* Modifications are admitted until the load factor reaches AT_MAX_LOAD_NUM / AT_MAX_LOAD_DEN.
+static const size_t AT_MAX_LOAD_NUM = 1;
+static const size_t AT_MAX_LOAD_DEN = 2;
+
+//* Number of slots reported as a single bucket.
+static const size_t AT_GROUP_SIZE = 16;
+
+//* Number of elements batched lookup prefetches slots ahead.
+static const size_t AT_BATCH_DISTANCE = 16;
+
+//* Tickets are split between stripes of their own cache lines, every thread takes them from its home stripe first.
+static const size_t AT_STRIPE_COUNT = 16;
+
+typedef unsigned at_status_t;
+
+enum AT_STATUS {
+    AT_NULL         = 1 << 0,
+    AT_NO_CONTENT   = 1 << 1,
+};
+
+/**
+ * @brief Ticket counters of a stripe of the array.
+ *
+ * @param admitted number of tickets taken from the stripe (might exceed the quota, extra ones are rejected)
+ * @param completed number of finished modifications of the threads this stripe is home to
+ */
+struct alignas(64) AtomicStripe {
+    size_t admitted = 0;
+    size_t completed = 0;
+};
+
+/**
+ * @brief Slot array of the atomic table.
+ *
+ * Every modification of the array takes a ticket first. Tickets are limited by the max load of the array,
+ * so the array always has empty slots and every probe sequence terminates. Each stripe admits quota tickets,
+ * so threads only share counters once their home stripes run out.
+ *
+ * @param capacity number of slots (power of two)
+ * @param stripe_count number of stripes in use (at most AT_STRIPE_COUNT)
+ * @param quota number of tickets every stripe admits
+ * @param growing true once a thread has found all stripes exhausted and started the replacement
+ * @param full true if the array has run out of tickets and could not be replaced
+ * @param states state of each slot
+ * @param keys elements
+ * @param previous array this one has replaced (kept until the table is destroyed, as readers might still use it)
+ * @param stripes ticket counters
+ */
+struct AtomicArray {
+    size_t capacity = 0;
+    size_t stripe_count = 0;
+    size_t quota = 0;
+    bool growing = false;
+    bool full = false;
+    ht_tag_t* states = NULL;
+    HT_ELEM_T* keys = NULL;
+    AtomicArray* previous = NULL;
+    AtomicStripe stripes[AT_STRIPE_COUNT] = {};
+};
+
+/**
+ * @brief Hash table any number of threads can insert to at the same time.
+ *
+ * Inserters claim empty slots with compare-and-swap and never take locks. Slots never become empty again,
+ * so inserters of the same key meet at the same first empty slot of its probe sequence and only one of them
+ * stores it. The array is replaced once it runs out of tickets: the thread which has found every stripe
+ * exhausted first waits for the admitted modifications to finish and rehashes the array, modifications
+ * arriving meanwhile wait for the new array. Readers never wait.
+ *
+ * @param array current slot array
+ * @param size number of stored elements
+ * @param hash_fn function used to recalculate hashes on table growth (NULL if the table should never grow)
+ * @param arena storage of the long keys (shared by all inserters)
+ */
+struct AtomicTable {
+    AtomicArray* array = NULL;
+    size_t size = 0;
+    hash_fn_t* hash_fn = NULL;
+    KeyArena arena = {};
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Construct atomic table data structure
+ *
+ * @param table pointer to the table
+ * @param bucket_count initial number of slot groups (rounded up to a power of two)
+ * @param hash_fn hash function the table is going to be used with (NULL to keep the capacity fixed)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void AtomicTable_ctor(AtomicTable* table, size_t bucket_count, hash_fn_t* hash_fn, ERROR_MARKER);
+
+/**
+ * @brief Destroy the table (should not be called while other threads are using it)
+ *
+ * @param table pointer to the table to destroy
+ */
+void AtomicTable_dtor(AtomicTable* table);
+
+/**
+ * @brief Get status of the table
+ *
+ * @param table pointer to the table
+ * @return at_status_t
+ */
+at_status_t AtomicTable_status(const AtomicTable* table);
+
+/**
+ * @brief Insert an element (thread-safe, the element is stored once even if several threads insert it)
+ *
+ * @param table pointer to the table
+ * @param hash hash of the new element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void AtomicTable_insert(AtomicTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Remove an element from the table (thread-safe)
+ *
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the element was present in the table
+ */
+bool AtomicTable_erase(AtomicTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Find element in the table by its hash and value (thread-safe, never waits)
+ *
+ * @param table table to search in
+ * @param hash hash of the element
+ * @param value exact value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @return pointer to the element cell in the table (NULL if the element was not found),
+ *         the cell is never overwritten and stays allocated until the table is destroyed
+ */
+HT_ELEM_T* AtomicTable_find_value(const AtomicTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Find several elements in the table, prefetching their slots ahead of time (thread-safe)
+ *
+ * @param table table to search in
+ * @param hashes hashes of the elements
+ * @param values exact values of the elements
+ * @param count number of elements to search for
+ * @param results array the pointers to the found cells are written to (NULL for absent elements)
+ * @param comparator comparator function between elements (should return 0 on equality)
+ */
+void AtomicTable_find_batch(const AtomicTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                            HT_ELEM_T** results, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Get the number of slot groups in the table
+ *
+ * @param table
+ * @return size_t
+ */
+size_t AtomicTable_bucket_count(const AtomicTable* table);
+
+/**
+ * @brief Get the number of elements stored in the specified slot group
+ *
+ * @param table
+ * @param bucket_id index of the group
+ * @return size_t
+ */
+size_t AtomicTable_bucket_size(const AtomicTable* table, size_t bucket_id);
+
+
+//* IMPLEMENTATIONS ==============================
+
+static inline ht_tag_t _AtomicTable_tag(hash_t hash) { return (ht_tag_t) (AT_FULL | (hash >> 57)); }
+
+static AtomicArray* _AtomicArray_new(size_t capacity, err_anchor_t err_code) {
+    AtomicArray* array = NULL;
+    int alloc_status = posix_memalign((void**) &array, 64, sizeof(*array));
+    _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, return NULL, err_code, ENOMEM);
+
+    *array = {};
+
+    alloc_status = posix_memalign((void**) &array->keys, 32, capacity * sizeof(*array->keys));
+    array->states = (ht_tag_t*) calloc(capacity, sizeof(*array->states));
+
+    _LOG_FAIL_CHECK_(alloc_status == 0 && array->states, "error", ERROR_REPORTS, {
+        if (alloc_status == 0) free(array->keys);
+        free(array->states);
+        free(array);
+        return NULL;
+    }, err_code, ENOMEM);
+
+    size_t limit = capacity * AT_MAX_LOAD_NUM / AT_MAX_LOAD_DEN;
+
+    array->capacity = capacity;
+    array->stripe_count = limit < AT_STRIPE_COUNT ? limit : AT_STRIPE_COUNT;
+    array->quota = limit / array->stripe_count;
+
+    return array;
+}
+
+/**
+ * @brief Get the index of the home stripe of the calling thread (threads are spread over the stripes in order of arrival).
+ */
+static inline size_t _AtomicTable_home_stripe(const AtomicArray* array) {
+    static unsigned thread_counter = 0;
+    static thread_local unsigned thread_id = __atomic_fetch_add(&thread_counter, 1, __ATOMIC_RELAXED);
+
+    return thread_id % array->stripe_count;
+}
+
+/**
+ * @brief Take a ticket from the home stripe, or from any other stripe once it runs out.
+ *
+ * @return false if all stripes of the array have run out of tickets
+ */
+static bool _AtomicArray_admit(AtomicArray* array) {
+    size_t home = _AtomicTable_home_stripe(array);
+
+    for (size_t step = 0; step < array->stripe_count; ++step) {
+        AtomicStripe* stripe = &array->stripes[(home + step) % array->stripe_count];
+
+        //* Exhausted stripes are only read, so threads do not keep bouncing their lines.
+        if (__atomic_load_n(&stripe->admitted, __ATOMIC_RELAXED) >= array->quota) continue;
+        if (__atomic_fetch_add(&stripe->admitted, 1, __ATOMIC_RELAXED) < array->quota) return true;
+    }
+
+    return false;
+}
+
+static size_t _AtomicArray_completed(const AtomicArray* array) {
+    size_t completed = 0;
+    for (size_t stripe_id = 0; stripe_id < array->stripe_count; ++stripe_id) {
+        completed += __atomic_load_n(&array->stripes[stripe_id].completed, __ATOMIC_ACQUIRE);
+    }
+
+    return completed;
+}
+
+static void _AtomicArray_delete(AtomicArray* array) {
+    free(array->keys);
+    free(array->states);
+    free(array);
+}
+
+/**
+ * @brief Put the element to the first empty slot of its probe sequence (the array should not be shared yet).
+ */
+static void _AtomicArray_place(AtomicArray* array, hash_t hash, HT_ELEM_T value) {
+    size_t mask = array->capacity - 1;
+
+    size_t index = hash & mask;
+    while (array->states[index] != AT_EMPTY) index = (index + 1) & mask;
+
+    array->states[index] = _AtomicTable_tag(hash);
+    array->keys[index] = value;
+}
+
+static HT_ELEM_T* _AtomicArray_find(const AtomicArray* array, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator) {
+    ht_tag_t tag = _AtomicTable_tag(hash);
+    size_t mask = array->capacity - 1;
+
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        ht_tag_t state = __atomic_load_n(&array->states[index], __ATOMIC_ACQUIRE);
+
+        if (state == AT_EMPTY) return NULL;
+        if (state == tag && elem_equal(array->keys[index], value, comparator)) return &array->keys[index];
+    }
+}
+
+/**
+ * @brief Insert the element unless another thread has already inserted it.
+ *
+ * @return true if the element was inserted
+ */
+static bool _AtomicArray_insert(AtomicArray* array, KeyArena* arena, hash_t hash, HT_ELEM_T value,
+                                ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    ht_tag_t tag = _AtomicTable_tag(hash);
+    size_t mask = array->capacity - 1;
+
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        ht_tag_t state = __atomic_load_n(&array->states[index], __ATOMIC_ACQUIRE);
+
+        if (state == AT_EMPTY && __atomic_compare_exchange_n(&array->states[index], &state, AT_BUSY, false,
+                                                             __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            //* Inserters of the same key wait for the claimed slot, so the key is copied only once.
+            bool stored = KeyArena_store_elem_atomic(arena, &value, err_code);
+            if (stored) array->keys[index] = value;
+
+            __atomic_store_n(&array->states[index], stored ? tag : AT_ERASED, __ATOMIC_RELEASE);
+            return stored;
+        }
+
+        //* The slot might be claimed by an inserter of the same key.
+        while (state == AT_BUSY) {
+            _mm_pause();
+            state = __atomic_load_n(&array->states[index], __ATOMIC_ACQUIRE);
+        }
+
+        if (state == tag && elem_equal(array->keys[index], value, comparator)) return false;
+    }
+}
+
+/**
+ * @brief Replace the array which has run out of tickets.
+ */
+static void _AtomicTable_grow(AtomicTable* table, AtomicArray* old_array, err_anchor_t err_code) {
+    //* Every stripe has admitted its whole quota by now, and no more tickets are going to be admitted.
+    while (_AtomicArray_completed(old_array) < old_array->stripe_count * old_array->quota) _mm_pause();
+
+    size_t count = 0;
+    for (size_t index = 0; index < old_array->capacity; ++index) count += (old_array->states[index] & AT_FULL) != 0;
+
+    //* Erasures and rejected duplicates also take tickets, so the array might be rebuilt with the same capacity.
+    size_t capacity = old_array->capacity;
+    while (2 * count * AT_MAX_LOAD_DEN > capacity * AT_MAX_LOAD_NUM) capacity *= 2;
+
+    AtomicArray* new_array = table->hash_fn ? _AtomicArray_new(capacity, err_code) : NULL;
+
+    if (!new_array) {
+        __atomic_store_n(&old_array->full, true, __ATOMIC_RELEASE);
+        return;
+    }
+
+    for (size_t index = 0; index < old_array->capacity; ++index) {
+        if (!(old_array->states[index] & AT_FULL)) continue;
+
+        HT_ELEM_T key = old_array->keys[index];
+        _AtomicArray_place(new_array, hash_elem(table->hash_fn, &key), key);
+    }
+
+    //* Elements moved to the new array hold its tickets.
+    for (size_t stripe_id = 0, left = count; stripe_id < new_array->stripe_count; ++stripe_id) {
+        size_t taken = left < new_array->quota ? left : new_array->quota;
+        new_array->stripes[stripe_id].admitted = taken;
+        new_array->stripes[stripe_id].completed = taken;
+        left -= taken;
+    }
+
+    new_array->previous = old_array;
+
+    __atomic_store_n(&table->array, new_array, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Take a ticket of the current array, waiting for the array replacement if it has run out of them.
+ *
+ * @return array the modification should be applied to (NULL if the table can not grow anymore)
+ */
+static AtomicArray* _AtomicTable_enter(AtomicTable* table, err_anchor_t err_code) {
+    for (;;) {
+        AtomicArray* array = __atomic_load_n(&table->array, __ATOMIC_ACQUIRE);
+
+        if (_AtomicArray_admit(array)) return array;
+
+        if (!__atomic_exchange_n(&array->growing, true, __ATOMIC_ACQ_REL)) _AtomicTable_grow(table, array, err_code);
+
+        bool full = false;
+        while (__atomic_load_n(&table->array, __ATOMIC_ACQUIRE) == array &&
+               !(full = __atomic_load_n(&array->full, __ATOMIC_ACQUIRE))) _mm_pause();
+
+        _LOG_FAIL_CHECK_(!full, "error", ERROR_REPORTS, return NULL, err_code, ENOMEM);
+    }
+}
+
+static inline void _AtomicTable_leave(AtomicArray* array) {
+    __atomic_fetch_add(&array->stripes[_AtomicTable_home_stripe(array)].completed, 1, __ATOMIC_RELEASE);
+}
+
+void AtomicTable_ctor(AtomicTable* table, size_t bucket_count, hash_fn_t* hash_fn, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(table, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(bucket_count > 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *table = {};
+    table->hash_fn = hash_fn;
+
+    size_t capacity = AT_GROUP_SIZE;
+    while (capacity < bucket_count * AT_GROUP_SIZE) capacity *= 2;
+
+    table->array = _AtomicArray_new(capacity, err_code);
+}
+
+void AtomicTable_dtor(AtomicTable* table) {
+    _LOG_FAIL_CHECK_(AtomicTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    while (table->array) {
+        AtomicArray* previous = table->array->previous;
+        _AtomicArray_delete(table->array);
+        table->array = previous;
+    }
+
+    KeyArena_dtor(&table->arena);
+
+    *table = {};
+}
+
+at_status_t AtomicTable_status(const AtomicTable* table) {
+    if (!table) return AT_NULL;
+
+    //* The array might be replaced by another thread meanwhile.
+    const AtomicArray* array = __atomic_load_n(&table->array, __ATOMIC_ACQUIRE);
+    if (!array || !array->states || !array->keys) return AT_NO_CONTENT;
+
+    return 0;
+}
+
+void AtomicTable_insert(AtomicTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(AtomicTable_status(table) == 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    AtomicArray* array = _AtomicTable_enter(table, err_code);
+    if (!array) return;
+
+    if (_AtomicArray_insert(array, &table->arena, hash, value, comparator, err_code)) {
+        __atomic_add_fetch(&table->size, 1, __ATOMIC_RELAXED);
+    }
+
+    _AtomicTable_leave(array);
+}
+
+bool AtomicTable_erase(AtomicTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(AtomicTable_status(table) == 0, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    AtomicArray* array = _AtomicTable_enter(table, err_code);
+    if (!array) return false;
+
+    //* Erased slots keep their keys, so readers that have already matched the tag compare a valid key.
+    HT_ELEM_T* cell = _AtomicArray_find(array, hash, value, comparator);
+    ht_tag_t tag = _AtomicTable_tag(hash);
+
+    bool found = cell && __atomic_compare_exchange_n(&array->states[cell - array->keys], &tag, AT_ERASED, false,
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+
+    if (found) __atomic_sub_fetch(&table->size, 1, __ATOMIC_RELAXED);
+
+    _AtomicTable_leave(array);
+
+    return found;
+}
+
+HT_ELEM_T* AtomicTable_find_value(const AtomicTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(AtomicTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, NULL, EINVAL);
+
+    return _AtomicArray_find(__atomic_load_n(&table->array, __ATOMIC_ACQUIRE), hash, value, comparator);
+}
+
+void AtomicTable_find_batch(const AtomicTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                            HT_ELEM_T** results, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(AtomicTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(count == 0 || (hashes && values && results), "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    const AtomicArray* array = __atomic_load_n(&table->array, __ATOMIC_ACQUIRE);
+    size_t mask = array->capacity - 1;
+
+    for (size_t id = 0; id < count; ++id) {
+        if (id + AT_BATCH_DISTANCE < count) {
+            size_t index = hashes[id + AT_BATCH_DISTANCE] & mask;
+            _mm_prefetch((const char*) &array->states[index], _MM_HINT_T0);
+            _mm_prefetch((const char*) &array->keys[index], _MM_HINT_T0);
+        }
+
+        results[id] = _AtomicArray_find(array, hashes[id], values[id], comparator);
+    }
+}
+
+size_t AtomicTable_bucket_count(const AtomicTable* table) {
+    _LOG_FAIL_CHECK_(AtomicTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    return __atomic_load_n(&table->array, __ATOMIC_ACQUIRE)->capacity / AT_GROUP_SIZE;
+}
+
+size_t AtomicTable_bucket_size(const AtomicTable* table, size_t bucket_id) {
+    _LOG_FAIL_CHECK_(AtomicTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    const AtomicArray* array = __atomic_load_n(&table->array, __ATOMIC_ACQUIRE);
+    _LOG_FAIL_CHECK_(bucket_id < array->capacity / AT_GROUP_SIZE, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    size_t size = 0;
+    for (size_t index = bucket_id * AT_GROUP_SIZE; index < (bucket_id + 1) * AT_GROUP_SIZE; ++index) {
+        size += (__atomic_load_n(&array->states[index], __ATOMIC_RELAXED) & AT_FULL) != 0;
+    }
+
+    return size;
+}
+
+#endif
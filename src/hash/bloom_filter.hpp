@@ -0,0 +1,237 @@
+/**
+ * @file bloom_filter.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Split-block Bloom filter answering membership queries with a single cache line access.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef BLOOM_FILTER_HPP
+#define BLOOM_FILTER_HPP
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "lib/util/dbg/debug.h"
+#include "src/utils/config.h"
+
+#include "hash.h"
+
+//* Number of filter bits per expected key (gives false positive rate of about 0.1%).
+static const size_t BLOOM_BITS_PER_KEY = 16;
+
+//* Size of a block in bits. Every key sets one bit in each of the eight 32-bit words of its block.
+static const size_t BLOOM_BLOCK_BITS = 256;
+static const size_t BLOOM_WORD_COUNT = 8;
+
+typedef unsigned bloom_status_t;
+
+enum BLOOM_STATUS {
+    BLOOM_NULL          = 1 << 0,
+    BLOOM_NO_CONTENT    = 1 << 1,
+};
+
+/**
+ * @brief Blocked Bloom filter of element hashes.
+ *
+ * Every hash selects a single 32-byte block and sets one bit in each of its words,
+ * so insertion and query cost one cache line access and one AVX2 instruction each.
+ * Elements can not be removed from the filter.
+ *
+ * @param block_count number of blocks
+ * @param blocks bit blocks
+ * @param inserted number of hashes added to the filter
+ */
+struct BloomFilter {
+    size_t block_count = 0;
+    __m256i* blocks = NULL;
+    size_t inserted = 0;
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Construct the filter for the expected number of keys
+ *
+ * @param filter pointer to the filter
+ * @param expected_count number of keys the filter is sized for
+ * @param err_code pointer to the errno-functioning variable
+ */
+void BloomFilter_ctor(BloomFilter* filter, size_t expected_count, ERROR_MARKER);
+
+/**
+ * @brief Destroy the filter
+ *
+ * @param filter pointer to the filter to destroy
+ */
+void BloomFilter_dtor(BloomFilter* filter);
+
+/**
+ * @brief Get status of the filter
+ *
+ * @param filter pointer to the filter
+ * @return bloom_status_t
+ */
+bloom_status_t BloomFilter_status(const BloomFilter* filter);
+
+/**
+ * @brief Remove all hashes from the filter
+ *
+ * @param filter pointer to the filter (should be constructed)
+ */
+void BloomFilter_clear(BloomFilter* filter);
+
+/**
+ * @brief Add the hash to the filter
+ *
+ * @param filter pointer to the filter (should be constructed)
+ * @param hash
+ */
+static inline void BloomFilter_add(BloomFilter* filter, hash_t hash);
+
+/**
+ * @brief Check if the hash might have been added to the filter
+ *
+ * @param filter pointer to the filter (should be constructed)
+ * @param hash
+ * @return false if the hash was definitely never added
+ */
+static inline bool BloomFilter_may_contain(const BloomFilter* filter, hash_t hash);
+
+/**
+ * @brief Request the block of the hash from memory
+ *
+ * @param filter pointer to the filter (should be constructed)
+ * @param hash
+ */
+static inline void BloomFilter_prefetch(const BloomFilter* filter, hash_t hash);
+
+/**
+ * @brief Estimate probability of the filter letting an absent key through at its current fill
+ *
+ * @param filter pointer to the filter
+ * @return double
+ */
+double BloomFilter_false_positive_rate(const BloomFilter* filter);
+
+/**
+ * @brief Get the number of bytes the filter occupies
+ *
+ * @param filter pointer to the filter
+ * @return size_t
+ */
+size_t BloomFilter_footprint(const BloomFilter* filter);
+
+
+//* IMPLEMENTATIONS ==============================
+
+//* Hashes are mixed first, so the filter does not reuse the bits the table selects buckets with.
+static inline hash_t _BloomFilter_mix(hash_t hash) {
+    return hash * 0x9E3779B97F4A7C15ULL;
+}
+
+static inline const __m256i* _BloomFilter_block(const BloomFilter* filter, hash_t mixed) {
+    return filter->blocks + (size_t) (((__uint128_t) (mixed >> 32) * filter->block_count) >> 32);
+}
+
+/**
+ * @brief Get the block mask of the hash: each of its words is multiplied by an odd salt and keeps its top 5 bits.
+ */
+static inline __m256i _BloomFilter_mask(hash_t mixed) {
+    const __m256i salts = _mm256_setr_epi32((int) 0x47B6137Bu, (int) 0x44974D91u, (int) 0x8824AD5Bu, (int) 0xA2B7289Du,
+                                            (int) 0x705495C7u, (int) 0x2DF1424Bu, (int) 0x9EFC4947u, (int) 0x5C6BFB31u);
+
+    __m256i bit_ids = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((int) (uint32_t) mixed), salts), 27);
+    return _mm256_sllv_epi32(_mm256_set1_epi32(1), bit_ids);
+}
+
+static inline void BloomFilter_add(BloomFilter* filter, hash_t hash) {
+    hash_t mixed = _BloomFilter_mix(hash);
+    __m256i* block = (__m256i*) _BloomFilter_block(filter, mixed);
+
+    _mm256_store_si256(block, _mm256_or_si256(_mm256_load_si256(block), _BloomFilter_mask(mixed)));
+    ++filter->inserted;
+}
+
+static inline bool BloomFilter_may_contain(const BloomFilter* filter, hash_t hash) {
+    hash_t mixed = _BloomFilter_mix(hash);
+    return _mm256_testc_si256(_mm256_load_si256(_BloomFilter_block(filter, mixed)), _BloomFilter_mask(mixed));
+}
+
+static inline void BloomFilter_prefetch(const BloomFilter* filter, hash_t hash) {
+    _mm_prefetch((const char*) _BloomFilter_block(filter, _BloomFilter_mix(hash)), _MM_HINT_T0);
+}
+
+void BloomFilter_ctor(BloomFilter* filter, size_t expected_count, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(filter, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *filter = {};
+
+    size_t block_count = (expected_count * BLOOM_BITS_PER_KEY + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+    if (block_count == 0) block_count = 1;
+
+    _LOG_FAIL_CHECK_(block_count <= UINT32_MAX, "error", ERROR_REPORTS, return, err_code, EFBIG);
+
+    int alloc_status = posix_memalign((void**) &filter->blocks, 64, block_count * sizeof(*filter->blocks));
+    _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, { filter->blocks = NULL; return; }, err_code, ENOMEM);
+
+    memset(filter->blocks, 0, block_count * sizeof(*filter->blocks));
+    filter->block_count = block_count;
+}
+
+void BloomFilter_dtor(BloomFilter* filter) {
+    _LOG_FAIL_CHECK_(filter, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    free(filter->blocks);
+
+    *filter = {};
+}
+
+void BloomFilter_clear(BloomFilter* filter) {
+    _LOG_FAIL_CHECK_(BloomFilter_status(filter) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    memset(filter->blocks, 0, filter->block_count * sizeof(*filter->blocks));
+    filter->inserted = 0;
+}
+
+bloom_status_t BloomFilter_status(const BloomFilter* filter) {
+    if (!filter) return BLOOM_NULL;
+    if (!filter->blocks || !filter->block_count) return BLOOM_NO_CONTENT;
+
+    return 0;
+}
+
+double BloomFilter_false_positive_rate(const BloomFilter* filter) {
+    _LOG_FAIL_CHECK_(BloomFilter_status(filter) == 0, "error", ERROR_REPORTS, return 1.0, NULL, EINVAL);
+
+    //* A bit of a word stays clear with probability (1 - 1/32)^n, where n is the number of keys in the block.
+    //* Block loads are Poisson-distributed, so the rate is averaged over the loads within ten deviations of the mean.
+    if (filter->inserted == 0) return 0.0;
+
+    double mean_load = (double) filter->inserted / (double) filter->block_count;
+
+    double spread = 10.0 * sqrt(mean_load) + 10.0;
+    double rate = 0.0;
+
+    for (double load = fmax(0.0, floor(mean_load - spread)); load <= mean_load + spread; load += 1.0) {
+        double load_probability = exp(load * log(mean_load) - mean_load - lgamma(load + 1.0));
+        double word_hit = 1.0 - pow(1.0 - 1.0 / 32.0, load);
+        rate += load_probability * pow(word_hit, (double) BLOOM_WORD_COUNT);
+    }
+
+    return rate;
+}
+
+size_t BloomFilter_footprint(const BloomFilter* filter) {
+    _LOG_FAIL_CHECK_(BloomFilter_status(filter) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    return sizeof(*filter) + filter->block_count * sizeof(*filter->blocks);
+}
+
+#endif
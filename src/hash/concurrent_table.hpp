@@ -0,0 +1,560 @@
+/**
+ * @file concurrent_table.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Chained hash table with lock-free readers.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef CONCURRENT_TABLE_HPP
+#define CONCURRENT_TABLE_HPP
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "src/utils/config.h"
+
+#include "table_elem.h"
+#include "hash_bucket.hpp"
+#include "fast_mod.h"
+#include "key_arena.hpp"
+
+//* Number of elements stored in a single block of the bucket chain (chosen so the block fills whole cache lines).
+#if OPTIMIZATION_LEVEL < 1
+static const size_t CT_BLOCK_SIZE = 5;
+#else
+static const size_t CT_BLOCK_SIZE = 3;
+#endif
+
+//* Tag storage is padded so the elements of the block start at a 32-byte boundary.
+static const size_t CT_BLOCK_TAG_COUNT = 8;
+
+static const size_t CT_GROWTH_FACTOR = 2;
+
+//* Number of elements batched lookup prefetches buckets ahead.
+static const size_t CT_BATCH_DISTANCE = 16;
+
+typedef unsigned ct_status_t;
+
+enum CT_STATUS {
+    CT_NULL         = 1 << 0,
+    CT_NO_CONTENT   = 1 << 1,
+};
+
+/**
+ * @brief Block of the bucket chain. The first block of every bucket is stored in the bucket array.
+ *
+ * @param version seqlock of the bucket, odd while the bucket is modified (only used in the first block)
+ * @param size number of elements in the whole chain (only used in the first block)
+ * @param next next block of the chain (blocks are only released with the table)
+ * @param tags fingerprints of the elements
+ * @param keys elements
+ */
+struct ConcurrentBlock {
+    uint32_t version = 0;
+    uint32_t size = 0;
+    ConcurrentBlock* next = NULL;
+    ht_tag_t tags[CT_BLOCK_TAG_COUNT] = {};
+    HT_ELEM_T keys[CT_BLOCK_SIZE] = {};
+};
+
+/**
+ * @brief Bucket array of the concurrent table.
+ *
+ * @param bucket_count number of buckets
+ * @param bucket_mod precomputed reduction of hashes modulo bucket_count
+ * @param buckets first blocks of the bucket chains
+ * @param previous array this one has replaced (kept until the table is destroyed, as readers might still use it)
+ */
+struct ConcurrentArray {
+    size_t bucket_count = 0;
+    FastMod bucket_mod = {};
+    ConcurrentBlock* buckets = NULL;
+    ConcurrentArray* previous = NULL;
+};
+
+/**
+ * @brief Hash table for many concurrent readers and a few writers.
+ *
+ * Readers never take locks: they check the version of the bucket before and after reading it
+ * and retry if a writer has modified the bucket meanwhile. Writers lock single buckets and share
+ * the table with each other, only growth of the table locks it exclusively. Growth copies the table
+ * to a new bucket array, readers of the old array keep seeing its last state until they finish.
+ *
+ * @param array current bucket array
+ * @param size number of stored elements
+ * @param hash_fn function used to recalculate hashes on table growth (NULL if the table should never grow)
+ * @param resize_lock lock writers share and growth takes exclusively
+ * @param arena_lock lock of the long key storage
+ * @param arena storage of the long keys
+ */
+struct ConcurrentTable {
+    ConcurrentArray* array = NULL;
+    size_t size = 0;
+    hash_fn_t* hash_fn = NULL;
+    pthread_rwlock_t resize_lock = PTHREAD_RWLOCK_INITIALIZER;
+    pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+    KeyArena arena = {};
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Construct concurrent table data structure
+ *
+ * @param table pointer to the table
+ * @param bucket_count initial number of buckets
+ * @param hash_fn hash function the table is going to be used with (NULL to keep the bucket count fixed)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void ConcurrentTable_ctor(ConcurrentTable* table, size_t bucket_count, hash_fn_t* hash_fn, ERROR_MARKER);
+
+/**
+ * @brief Destroy the table (should not be called while other threads are using it)
+ *
+ * @param table pointer to the table to destroy
+ */
+void ConcurrentTable_dtor(ConcurrentTable* table);
+
+/**
+ * @brief Get status of the table
+ *
+ * @param table pointer to the table
+ * @return ct_status_t
+ */
+ct_status_t ConcurrentTable_status(const ConcurrentTable* table);
+
+/**
+ * @brief Insert an element (thread-safe)
+ *
+ * @param table pointer to the table
+ * @param hash hash of the new element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void ConcurrentTable_insert(ConcurrentTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Remove an element from the table (thread-safe)
+ *
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the element was present in the table
+ */
+bool ConcurrentTable_erase(ConcurrentTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Find element in the table by its hash and value (thread-safe, never blocks writers)
+ *
+ * @param table table to search in
+ * @param hash hash of the element
+ * @param value exact value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @return pointer to the element cell in the table (NULL if the element was not found),
+ *         the cell stays allocated until the table is destroyed, but writers may change its contents
+ */
+HT_ELEM_T* ConcurrentTable_find_value(const ConcurrentTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Find several elements in the table, prefetching their buckets ahead of time (thread-safe)
+ *
+ * @param table table to search in
+ * @param hashes hashes of the elements
+ * @param values exact values of the elements
+ * @param count number of elements to search for
+ * @param results array the pointers to the found cells are written to (NULL for absent elements)
+ * @param comparator comparator function between elements (should return 0 on equality)
+ */
+void ConcurrentTable_find_batch(const ConcurrentTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                                HT_ELEM_T** results, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Get the number of buckets in the table
+ *
+ * @param table
+ * @return size_t
+ */
+size_t ConcurrentTable_bucket_count(const ConcurrentTable* table);
+
+/**
+ * @brief Get the number of elements stored in the specified bucket
+ *
+ * @param table
+ * @param bucket_id index of the bucket
+ * @return size_t
+ */
+size_t ConcurrentTable_bucket_size(const ConcurrentTable* table, size_t bucket_id);
+
+
+//* IMPLEMENTATIONS ==============================
+
+static inline ht_tag_t _ConcurrentTable_tag(hash_t hash) { return (ht_tag_t) (hash >> 56); }
+
+static inline ConcurrentBlock* _ConcurrentArray_bucket(const ConcurrentArray* array, hash_t hash) {
+    return &array->buckets[FastMod_reduce(&array->bucket_mod, hash)];
+}
+
+static ConcurrentArray* _ConcurrentArray_new(size_t bucket_count, err_anchor_t err_code) {
+    ConcurrentArray* array = (ConcurrentArray*) calloc(1, sizeof(*array));
+    _LOG_FAIL_CHECK_(array, "error", ERROR_REPORTS, return NULL, err_code, ENOMEM);
+
+    int alloc_status = posix_memalign((void**) &array->buckets, 64, bucket_count * sizeof(*array->buckets));
+    _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, { free(array); return NULL; }, err_code, ENOMEM);
+
+    memset((void*) array->buckets, 0, bucket_count * sizeof(*array->buckets));
+
+    array->bucket_count = bucket_count;
+    FastMod_ctor(&array->bucket_mod, bucket_count);
+
+    return array;
+}
+
+static void _ConcurrentArray_delete(ConcurrentArray* array) {
+    for (size_t bucket_id = 0; bucket_id < array->bucket_count; ++bucket_id) {
+        ConcurrentBlock* block = array->buckets[bucket_id].next;
+
+        while (block) {
+            ConcurrentBlock* next = block->next;
+            free(block);
+            block = next;
+        }
+    }
+
+    free(array->buckets);
+    free(array);
+}
+
+/**
+ * @brief Wait until no writer modifies the bucket and lock it.
+ */
+static void _ConcurrentBucket_lock(ConcurrentBlock* bucket) {
+    for (;;) {
+        uint32_t version = __atomic_load_n(&bucket->version, __ATOMIC_RELAXED);
+
+        if (!(version & 1) && __atomic_compare_exchange_n(&bucket->version, &version, version + 1, false,
+                                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) break;
+
+        _mm_pause();
+    }
+
+    //* Changes of the bucket should not become visible before its version turns odd.
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void _ConcurrentBucket_unlock(ConcurrentBlock* bucket) {
+    __atomic_store_n(&bucket->version, bucket->version + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Wait until no writer modifies the bucket and get its version.
+ */
+static inline uint32_t _ConcurrentBucket_read_begin(const ConcurrentBlock* bucket) {
+    for (;;) {
+        uint32_t version = __atomic_load_n(&bucket->version, __ATOMIC_ACQUIRE);
+        if (!(version & 1)) return version;
+
+        _mm_pause();
+    }
+}
+
+/**
+ * @brief Check that the bucket was not modified since its version was read.
+ */
+static inline bool _ConcurrentBucket_read_valid(const ConcurrentBlock* bucket, uint32_t version) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&bucket->version, __ATOMIC_RELAXED) == version;
+}
+
+/**
+ * @brief Get the block of the bucket chain containing the element.
+ */
+static ConcurrentBlock* _ConcurrentBucket_block(ConcurrentBlock* bucket, size_t elem_id) {
+    ConcurrentBlock* block = bucket;
+    for (size_t block_id = elem_id / CT_BLOCK_SIZE; block_id > 0; --block_id) block = block->next;
+
+    return block;
+}
+
+/**
+ * @brief Find element in the bucket the caller has locked.
+ *
+ * @return index of the element in the bucket chain (bucket size if the element was not found)
+ */
+static size_t _ConcurrentBucket_locate(ConcurrentBlock* bucket, HT_ELEM_T value, ht_tag_t tag, ht_compar_fn_t* comparator) {
+    ConcurrentBlock* block = bucket;
+
+    for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id) {
+        if (elem_id && elem_id % CT_BLOCK_SIZE == 0) block = block->next;
+
+        size_t slot = elem_id % CT_BLOCK_SIZE;
+        if (block->tags[slot] == tag && elem_equal(block->keys[slot], value, comparator)) return elem_id;
+    }
+
+    return bucket->size;
+}
+
+/**
+ * @brief Append element to the bucket the caller has locked (or to the unpublished bucket).
+ */
+static bool _ConcurrentBucket_push(ConcurrentBlock* bucket, HT_ELEM_T value, ht_tag_t tag, err_anchor_t err_code) {
+    ConcurrentBlock* block = bucket;
+
+    //* Blocks emptied by erasure stay in the chain and get reused.
+    for (size_t block_id = bucket->size / CT_BLOCK_SIZE; block_id > 0; --block_id) {
+        if (!block->next) {
+            ConcurrentBlock* new_block = NULL;
+            int alloc_status = posix_memalign((void**) &new_block, 64, sizeof(*new_block));
+            _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, return false, err_code, ENOMEM);
+
+            memset((void*) new_block, 0, sizeof(*new_block));
+            __atomic_store_n(&block->next, new_block, __ATOMIC_RELEASE);
+        }
+
+        block = block->next;
+    }
+
+    size_t slot = bucket->size % CT_BLOCK_SIZE;
+    block->tags[slot] = tag;
+    block->keys[slot] = value;
+
+    __atomic_store_n(&bucket->size, bucket->size + 1, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+/**
+ * @brief Look the element up in the bucket without locking it.
+ *
+ * Reads of the bucket race with its writers, so every candidate element is copied
+ * and validated before the comparison (long keys are never read through torn pointers).
+ *
+ * @return false if the bucket was modified during the lookup
+ */
+static bool _ConcurrentBucket_try_find(const ConcurrentBlock* bucket, uint32_t version, HT_ELEM_T value, ht_tag_t tag,
+                                       ht_compar_fn_t* comparator, HT_ELEM_T** result) {
+    size_t size = __atomic_load_n(&bucket->size, __ATOMIC_RELAXED);
+    const ConcurrentBlock* block = bucket;
+
+    *result = NULL;
+
+    for (size_t elem_id = 0; elem_id < size; ++elem_id) {
+        if (elem_id && elem_id % CT_BLOCK_SIZE == 0) {
+            block = __atomic_load_n(&block->next, __ATOMIC_ACQUIRE);
+            if (!block) return false;
+        }
+
+        size_t slot = elem_id % CT_BLOCK_SIZE;
+        if (block->tags[slot] != tag) continue;
+
+        HT_ELEM_T candidate = block->keys[slot];
+        if (!_ConcurrentBucket_read_valid(bucket, version)) return false;
+
+        if (elem_equal(candidate, value, comparator)) {
+            *result = (HT_ELEM_T*) &block->keys[slot];
+            return true;
+        }
+    }
+
+    return _ConcurrentBucket_read_valid(bucket, version);
+}
+
+/**
+ * @brief Copy long key to the arena (the arena is shared by all writers).
+ */
+static bool _ConcurrentTable_store_key(ConcurrentTable* table, HT_ELEM_T* value, err_anchor_t err_code) {
+    if (!elem_is_long(value)) return true;
+
+    pthread_mutex_lock(&table->arena_lock);
+    bool stored = KeyArena_store_elem(&table->arena, value, err_code);
+    pthread_mutex_unlock(&table->arena_lock);
+
+    return stored;
+}
+
+/**
+ * @brief Move the table to a bigger bucket array unless another writer has already done it.
+ */
+static void _ConcurrentTable_grow(ConcurrentTable* table, size_t old_bucket_count, err_anchor_t err_code) {
+    pthread_rwlock_wrlock(&table->resize_lock);
+
+    ConcurrentArray* old_array = table->array;
+    ConcurrentArray* new_array = NULL;
+
+    if (old_array->bucket_count == old_bucket_count) {
+        new_array = _ConcurrentArray_new(old_bucket_count * CT_GROWTH_FACTOR, err_code);
+    }
+
+    //* Writers are locked out and readers only read, so the old array can be copied without bucket locks.
+    for (size_t bucket_id = 0; new_array && bucket_id < old_array->bucket_count; ++bucket_id) {
+        ConcurrentBlock* bucket = &old_array->buckets[bucket_id];
+        ConcurrentBlock* block = bucket;
+
+        for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id) {
+            if (elem_id && elem_id % CT_BLOCK_SIZE == 0) block = block->next;
+
+            HT_ELEM_T key = block->keys[elem_id % CT_BLOCK_SIZE];
+            hash_t hash = hash_elem(table->hash_fn, &key);
+
+            _ConcurrentBucket_push(_ConcurrentArray_bucket(new_array, hash), key, _ConcurrentTable_tag(hash), err_code);
+        }
+    }
+
+    if (new_array) {
+        new_array->previous = old_array;
+        __atomic_store_n(&table->array, new_array, __ATOMIC_RELEASE);
+    }
+
+    pthread_rwlock_unlock(&table->resize_lock);
+}
+
+void ConcurrentTable_ctor(ConcurrentTable* table, size_t bucket_count, hash_fn_t* hash_fn, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(table, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(bucket_count > 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *table = {};
+    table->hash_fn = hash_fn;
+
+    pthread_rwlock_init(&table->resize_lock, NULL);
+    pthread_mutex_init(&table->arena_lock, NULL);
+
+    table->array = _ConcurrentArray_new(bucket_count, err_code);
+}
+
+void ConcurrentTable_dtor(ConcurrentTable* table) {
+    _LOG_FAIL_CHECK_(ConcurrentTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    while (table->array) {
+        ConcurrentArray* previous = table->array->previous;
+        _ConcurrentArray_delete(table->array);
+        table->array = previous;
+    }
+
+    KeyArena_dtor(&table->arena);
+
+    pthread_rwlock_destroy(&table->resize_lock);
+    pthread_mutex_destroy(&table->arena_lock);
+
+    *table = {};
+}
+
+ct_status_t ConcurrentTable_status(const ConcurrentTable* table) {
+    if (!table) return CT_NULL;
+    if (!table->array || !table->array->buckets) return CT_NO_CONTENT;
+
+    return 0;
+}
+
+void ConcurrentTable_insert(ConcurrentTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(ConcurrentTable_status(table) == 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    ht_tag_t tag = _ConcurrentTable_tag(hash);
+
+    pthread_rwlock_rdlock(&table->resize_lock);
+
+    size_t bucket_count = table->array->bucket_count;
+    ConcurrentBlock* bucket = _ConcurrentArray_bucket(table->array, hash);
+
+    _ConcurrentBucket_lock(bucket);
+
+    bool inserted = _ConcurrentBucket_locate(bucket, value, tag, comparator) == bucket->size &&
+                    _ConcurrentTable_store_key(table, &value, err_code) &&
+                    _ConcurrentBucket_push(bucket, value, tag, err_code);
+
+    _ConcurrentBucket_unlock(bucket);
+
+    size_t size = inserted ? __atomic_add_fetch(&table->size, 1, __ATOMIC_RELAXED) : 0;
+
+    pthread_rwlock_unlock(&table->resize_lock);
+
+    if (table->hash_fn && HT_MAX_LOAD_FACTOR && size > bucket_count * HT_MAX_LOAD_FACTOR) {
+        _ConcurrentTable_grow(table, bucket_count, err_code);
+    }
+}
+
+bool ConcurrentTable_erase(ConcurrentTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(ConcurrentTable_status(table) == 0, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    pthread_rwlock_rdlock(&table->resize_lock);
+
+    ConcurrentBlock* bucket = _ConcurrentArray_bucket(table->array, hash);
+
+    _ConcurrentBucket_lock(bucket);
+
+    size_t elem_id = _ConcurrentBucket_locate(bucket, value, _ConcurrentTable_tag(hash), comparator);
+    bool found = elem_id < bucket->size;
+
+    if (found) {
+        size_t last_id = bucket->size - 1;
+        ConcurrentBlock* block = _ConcurrentBucket_block(bucket, elem_id);
+        ConcurrentBlock* last_block = _ConcurrentBucket_block(bucket, last_id);
+
+        block->keys[elem_id % CT_BLOCK_SIZE] = last_block->keys[last_id % CT_BLOCK_SIZE];
+        block->tags[elem_id % CT_BLOCK_SIZE] = last_block->tags[last_id % CT_BLOCK_SIZE];
+
+        __atomic_store_n(&bucket->size, bucket->size - 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&table->size, 1, __ATOMIC_RELAXED);
+    }
+
+    _ConcurrentBucket_unlock(bucket);
+
+    pthread_rwlock_unlock(&table->resize_lock);
+
+    return found;
+}
+
+HT_ELEM_T* ConcurrentTable_find_value(const ConcurrentTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(ConcurrentTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, NULL, EINVAL);
+
+    const ConcurrentArray* array = __atomic_load_n(&table->array, __ATOMIC_ACQUIRE);
+    const ConcurrentBlock* bucket = _ConcurrentArray_bucket(array, hash);
+    ht_tag_t tag = _ConcurrentTable_tag(hash);
+
+    HT_ELEM_T* result = NULL;
+
+    while (!_ConcurrentBucket_try_find(bucket, _ConcurrentBucket_read_begin(bucket), value, tag, comparator, &result)) {
+        _mm_pause();
+    }
+
+    return result;
+}
+
+void ConcurrentTable_find_batch(const ConcurrentTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                                HT_ELEM_T** results, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(ConcurrentTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(count == 0 || (hashes && values && results), "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    for (size_t id = 0; id < count; ++id) {
+        if (id + CT_BATCH_DISTANCE < count) {
+            const ConcurrentArray* array = __atomic_load_n(&table->array, __ATOMIC_ACQUIRE);
+            _mm_prefetch((const char*) _ConcurrentArray_bucket(array, hashes[id + CT_BATCH_DISTANCE]), _MM_HINT_T0);
+        }
+
+        results[id] = ConcurrentTable_find_value(table, hashes[id], values[id], comparator);
+    }
+}
+
+size_t ConcurrentTable_bucket_count(const ConcurrentTable* table) {
+    _LOG_FAIL_CHECK_(ConcurrentTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    return __atomic_load_n(&table->array, __ATOMIC_ACQUIRE)->bucket_count;
+}
+
+size_t ConcurrentTable_bucket_size(const ConcurrentTable* table, size_t bucket_id) {
+    _LOG_FAIL_CHECK_(ConcurrentTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    const ConcurrentArray* array = __atomic_load_n(&table->array, __ATOMIC_ACQUIRE);
+    _LOG_FAIL_CHECK_(bucket_id < array->bucket_count, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    return __atomic_load_n(&array->buckets[bucket_id].size, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,568 @@
+/**
+ * @file cuckoo_table.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Bucketized cuckoo hash table.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef CUCKOO_TABLE_HPP
+#define CUCKOO_TABLE_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "src/utils/config.h"
+
+#include "table_elem.h"
+#include "key_arena.hpp"
+
+//* Number of slots in a bucket. Tags of both candidate buckets of a key are compared by a single SSE instruction.
+static const size_t CUCKOO_BUCKET_SIZE = 8;
+
+//* The table grows when its load factor exceeds CUCKOO_MAX_LOAD_NUM / CUCKOO_MAX_LOAD_DEN.
+static const size_t CUCKOO_MAX_LOAD_NUM = 19;
+static const size_t CUCKOO_MAX_LOAD_DEN = 20;
+
+//* The table shrinks when its load factor drops below 1 / CUCKOO_SHRINK_DIVISOR.
+static const size_t CUCKOO_SHRINK_DIVISOR = 8;
+
+//* Maximal number of buckets the search of a free slot visits before the table grows.
+static const size_t CUCKOO_MAX_SEARCH = 128;
+
+//* The table does not grow past CUCKOO_MAX_SPARSENESS slots per element to place a key: more than
+//* 2 * CUCKOO_BUCKET_SIZE keys with the same hash never fit their two buckets, however many buckets there are.
+static const size_t CUCKOO_MAX_SPARSENESS = 8;
+
+//* Number of keys batched lookup prefetches at once.
+static const size_t CUCKOO_BATCH_GROUP = 16;
+
+//* Tag of the empty slot.
+static const uint8_t CUCKOO_EMPTY = 0;
+
+typedef unsigned cuckoo_status_t;
+
+enum CUCKOO_STATUS {
+    CUCKOO_NULL         = 1 << 0,
+    CUCKOO_NO_CONTENT   = 1 << 1,
+    CUCKOO_BAD_CAPACITY = 1 << 2,
+    CUCKOO_BIG_SIZE     = 1 << 3,
+};
+
+/**
+ * @brief Bucketized cuckoo hash table.
+ *
+ * Every element is stored in one of its two candidate buckets. The second bucket is derived
+ * from the first one and the tag of the element, so elements can be moved between their buckets
+ * without being hashed again. Lookup reads the tags of both buckets and only the slots with matching tags.
+ *
+ * @param size number of stored elements
+ * @param min_bucket_count initial number of buckets (the table never shrinks below it)
+ * @param bucket_count number of buckets (power of two)
+ * @param tags tag of each slot (CUCKOO_EMPTY for empty slots)
+ * @param slots element storage followed by the values of the elements
+ * @param hash_fn function used to recalculate hashes on table growth
+ * @param arena storage of the long keys (keys of erased elements are only released with the table)
+ */
+struct CuckooTable {
+    size_t size = 0;
+    size_t min_bucket_count = 0;
+    size_t bucket_count = 0;
+    uint8_t* tags = NULL;
+    HT_ELEM_T* slots = NULL;
+    hash_fn_t* hash_fn = NULL;
+    KeyArena arena = {};
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Construct cuckoo table data structure
+ *
+ * @param table pointer to the table
+ * @param bucket_count initial number of buckets (rounded up to a power of two)
+ * @param hash_fn hash function the table is going to be used with
+ * @param err_code pointer to the errno-functioning variable
+ */
+void CuckooTable_ctor(CuckooTable* table, size_t bucket_count, hash_fn_t* hash_fn, ERROR_MARKER);
+
+/**
+ * @brief Destroy the table
+ *
+ * @param table pointer to the table to destroy
+ */
+void CuckooTable_dtor(CuckooTable* table);
+
+/**
+ * @brief Get status of the table
+ *
+ * @param table pointer to the table
+ * @return cuckoo_status_t
+ */
+cuckoo_status_t CuckooTable_status(const CuckooTable* table);
+
+/**
+ * @brief Insert an element
+ *
+ * @param table pointer to the table
+ * @param hash hash of the new element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void CuckooTable_insert(CuckooTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t comparator, ERROR_MARKER);
+
+/**
+ * @brief Find an element or insert it if it is not in the table
+ *
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return pointer to the value mapped to the element (zero-initialized for new elements, NULL on failure),
+ *         valid until the next insertion or erasure
+ */
+ht_value_t* CuckooTable_upsert(CuckooTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Remove an element from the table
+ *
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the element was present in the table
+ */
+bool CuckooTable_erase(CuckooTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Find element in the table by its hash and value
+ *
+ * @param table table to search in
+ * @param hash hash of the element
+ * @param value exact value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @return pointer to the element slot in the table (NULL if the element was not found)
+ */
+HT_ELEM_T* CuckooTable_find_value(const CuckooTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Find several elements in the table, prefetching their buckets ahead of time
+ *
+ * @param table table to search in
+ * @param hashes hashes of the elements
+ * @param values exact values of the elements
+ * @param count number of elements to search for
+ * @param results array the pointers to the found slots are written to (NULL for absent elements)
+ * @param comparator comparator function between elements (should return 0 on equality)
+ */
+void CuckooTable_find_batch(const CuckooTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                            HT_ELEM_T** results, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Get the number of buckets in the table
+ *
+ * @param table
+ * @return size_t
+ */
+size_t CuckooTable_bucket_count(const CuckooTable* table);
+
+/**
+ * @brief Get the number of elements stored in the specified bucket
+ *
+ * @param table
+ * @param bucket_id index of the bucket
+ * @return size_t
+ */
+size_t CuckooTable_bucket_size(const CuckooTable* table, size_t bucket_id);
+
+
+//* IMPLEMENTATIONS ==============================
+
+static inline uint8_t _CuckooTable_tag(hash_t hash) {
+    uint8_t tag = (uint8_t) (hash >> 56);
+    return tag == CUCKOO_EMPTY ? 1 : tag;
+}
+
+static inline size_t _CuckooTable_primary(const CuckooTable* table, hash_t hash) {
+    return (size_t) hash & (table->bucket_count - 1);
+}
+
+//* Alternative bucket only depends on the tag, so it is the same function in both directions.
+static inline size_t _CuckooTable_alternative(const CuckooTable* table, size_t bucket_id, uint8_t tag) {
+    return (bucket_id ^ ((size_t) tag * 0x5BD1E995u)) & (table->bucket_count - 1);
+}
+
+static inline void* _CuckooTable_values(const CuckooTable* table) {
+    return table->slots + table->bucket_count * CUCKOO_BUCKET_SIZE;
+}
+
+static inline __m128i _CuckooTable_load_tags(const CuckooTable* table, size_t bucket_id) {
+    return _mm_loadl_epi64((const __m128i*) (table->tags + bucket_id * CUCKOO_BUCKET_SIZE));
+}
+
+/**
+ * @brief Get bit mask of slots of the pair of buckets whose tag equals the specified one
+ *        (bits of the second bucket follow the bits of the first one).
+ */
+static inline unsigned _CuckooTable_match(const CuckooTable* table, size_t first, size_t second, uint8_t tag) {
+    __m128i tags = _mm_unpacklo_epi64(_CuckooTable_load_tags(table, first), _CuckooTable_load_tags(table, second));
+    return (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(tags, _mm_set1_epi8((char) tag)));
+}
+
+static inline size_t _CuckooTable_match_slot(size_t first, size_t second, unsigned bit) {
+    return bit < CUCKOO_BUCKET_SIZE ? first * CUCKOO_BUCKET_SIZE + bit : second * CUCKOO_BUCKET_SIZE + bit - CUCKOO_BUCKET_SIZE;
+}
+
+/**
+ * @brief Get index of an empty slot of the bucket (SIZE_MAX if the bucket is full).
+ */
+static inline size_t _CuckooTable_free_slot(const CuckooTable* table, size_t bucket_id) {
+    unsigned free_mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_CuckooTable_load_tags(table, bucket_id),
+                                                                     _mm_setzero_si128())) & 0xFF;
+    if (!free_mask) return SIZE_MAX;
+
+    return bucket_id * CUCKOO_BUCKET_SIZE + (size_t) __builtin_ctz(free_mask);
+}
+
+static inline void _CuckooTable_move(CuckooTable* table, size_t from, size_t to) {
+    void* values = _CuckooTable_values(table);
+
+    table->tags[to] = table->tags[from];
+    table->slots[to] = table->slots[from];
+    memcpy(value_at(values, to), value_at(values, from), HT_VALUE_SIZE);
+
+    table->tags[from] = CUCKOO_EMPTY;
+}
+
+/**
+ * @brief Bucket visited by the breadth-first search of a free slot.
+ *
+ * @param bucket_id index of the bucket
+ * @param parent index of the bucket the element would be moved from (-1 for candidate buckets of the new element)
+ * @param parent_slot index of the element slot in the parent bucket
+ */
+struct _CuckooStep {
+    size_t bucket_id;
+    int parent;
+    unsigned parent_slot;
+};
+
+static bool _CuckooTable_on_path(const _CuckooStep* steps, int step_id, size_t bucket_id) {
+    for (; step_id >= 0; step_id = steps[step_id].parent) {
+        if (steps[step_id].bucket_id == bucket_id) return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Free a slot in one of the candidate buckets of the hash, moving other elements to their alternative buckets.
+ *
+ * Elements are only moved along the path that ends with an empty slot, so a failed search changes nothing.
+ *
+ * @return index of the freed slot (SIZE_MAX if no path was found)
+ */
+static size_t _CuckooTable_make_room(CuckooTable* table, hash_t hash) {
+    size_t primary = _CuckooTable_primary(table, hash);
+    size_t secondary = _CuckooTable_alternative(table, primary, _CuckooTable_tag(hash));
+
+    size_t slot_id = _CuckooTable_free_slot(table, primary);
+    if (slot_id == SIZE_MAX) slot_id = _CuckooTable_free_slot(table, secondary);
+    if (slot_id != SIZE_MAX) return slot_id;
+
+    _CuckooStep steps[CUCKOO_MAX_SEARCH] = {};
+    steps[0] = {primary, -1, 0};
+    steps[1] = {secondary, -1, 0};
+    size_t step_count = 2;
+
+    for (size_t step_id = 0; step_id < step_count; ++step_id) {
+        size_t bucket_id = steps[step_id].bucket_id;
+
+        for (unsigned slot = 0; slot < CUCKOO_BUCKET_SIZE; ++slot) {
+            size_t victim = bucket_id * CUCKOO_BUCKET_SIZE + slot;
+            size_t next_bucket = _CuckooTable_alternative(table, bucket_id, table->tags[victim]);
+
+            //* Buckets repeated on the path would move the same slot twice.
+            if (_CuckooTable_on_path(steps, (int) step_id, next_bucket)) continue;
+
+            size_t free_slot = _CuckooTable_free_slot(table, next_bucket);
+
+            if (free_slot != SIZE_MAX) {
+                _CuckooTable_move(table, victim, free_slot);
+
+                for (int path_id = (int) step_id; steps[path_id].parent >= 0; path_id = steps[path_id].parent) {
+                    size_t from = steps[steps[path_id].parent].bucket_id * CUCKOO_BUCKET_SIZE + steps[path_id].parent_slot;
+                    _CuckooTable_move(table, from, victim);
+                    victim = from;
+                }
+
+                return victim;
+            }
+
+            if (step_count < CUCKOO_MAX_SEARCH) steps[step_count++] = {next_bucket, (int) step_id, slot};
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static void _CuckooTable_allocate(CuckooTable* table, size_t bucket_count, err_anchor_t err_code) {
+    table->tags = NULL;
+    table->slots = NULL;
+
+    size_t capacity = bucket_count * CUCKOO_BUCKET_SIZE;
+
+    int tag_status = posix_memalign((void**) &table->tags, 32, capacity * sizeof(*table->tags));
+    int slot_status = posix_memalign((void**) &table->slots, 32, capacity * (sizeof(*table->slots) + HT_VALUE_SIZE));
+
+    if (tag_status != 0 || slot_status != 0) {
+        free(table->tags);
+        free(table->slots);
+        table->tags = NULL;
+        table->slots = NULL;
+        if (err_code) *err_code = ENOMEM;
+        return;
+    }
+
+    memset(table->tags, CUCKOO_EMPTY, capacity * sizeof(*table->tags));
+    table->bucket_count = bucket_count;
+    table->size = 0;
+}
+
+/**
+ * @brief Move all elements to the new bucket array, doubling its size until every element fits.
+ *
+ * The table is left as it was if it would have to grow past the old bucket count and CUCKOO_MAX_SPARSENESS slots per element.
+ */
+static void _CuckooTable_rehash(CuckooTable* table, size_t new_bucket_count, err_anchor_t err_code) {
+    CuckooTable old_table = *table;
+    void* old_values = _CuckooTable_values(&old_table);
+
+    size_t max_bucket_count = (old_table.size + 1) * CUCKOO_MAX_SPARSENESS / CUCKOO_BUCKET_SIZE;
+    if (max_bucket_count < old_table.bucket_count) max_bucket_count = old_table.bucket_count;
+    if (max_bucket_count < old_table.min_bucket_count) max_bucket_count = old_table.min_bucket_count;
+
+    for (bool placed = false; !placed; new_bucket_count *= 2) {
+        _LOG_FAIL_CHECK_(new_bucket_count <= max_bucket_count, "error", ERROR_REPORTS, {
+            *table = old_table;
+            return;
+        }, err_code, ENOMEM);
+
+        _CuckooTable_allocate(table, new_bucket_count, err_code);
+        if (!table->tags) {
+            *table = old_table;
+            return;
+        }
+
+        void* values = _CuckooTable_values(table);
+        placed = true;
+
+        for (size_t slot_id = 0; placed && slot_id < old_table.bucket_count * CUCKOO_BUCKET_SIZE; ++slot_id) {
+            if (old_table.tags[slot_id] == CUCKOO_EMPTY) continue;
+
+            hash_t hash = hash_elem(table->hash_fn, &old_table.slots[slot_id]);
+            size_t new_slot = _CuckooTable_make_room(table, hash);
+
+            placed = new_slot != SIZE_MAX;
+            if (!placed) break;
+
+            table->tags[new_slot] = old_table.tags[slot_id];
+            table->slots[new_slot] = old_table.slots[slot_id];
+            memcpy(value_at(values, new_slot), value_at(old_values, slot_id), HT_VALUE_SIZE);
+        }
+
+        if (!placed) {
+            free(table->tags);
+            free(table->slots);
+        }
+    }
+
+    table->size = old_table.size;
+
+    free(old_table.tags);
+    free(old_table.slots);
+}
+
+void CuckooTable_ctor(CuckooTable* table, size_t bucket_count, hash_fn_t* hash_fn, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(table, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(hash_fn, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *table = {};
+    table->hash_fn = hash_fn;
+
+    size_t power = 1;
+    while (power < bucket_count) power *= 2;
+
+    _CuckooTable_allocate(table, power, err_code);
+    table->min_bucket_count = table->bucket_count;
+}
+
+void CuckooTable_dtor(CuckooTable* table) {
+    _LOG_FAIL_CHECK_(CuckooTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    free(table->tags);
+    free(table->slots);
+
+    KeyArena_dtor(&table->arena);
+
+    *table = {};
+}
+
+cuckoo_status_t CuckooTable_status(const CuckooTable* table) {
+    if (!table) return CUCKOO_NULL;
+    if (!table->tags || !table->slots) return CUCKOO_NO_CONTENT;
+
+    cuckoo_status_t status = 0;
+
+    if (table->bucket_count == 0 || (table->bucket_count & (table->bucket_count - 1))) status |= CUCKOO_BAD_CAPACITY;
+    if (table->size > table->bucket_count * CUCKOO_BUCKET_SIZE) status |= CUCKOO_BIG_SIZE;
+
+    return status;
+}
+
+void CuckooTable_insert(CuckooTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t comparator, err_anchor_t err_code) {
+    CuckooTable_upsert(table, hash, value, comparator, err_code);
+}
+
+ht_value_t* CuckooTable_upsert(CuckooTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator,
+                               err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(CuckooTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+
+    HT_ELEM_T* found = CuckooTable_find_value(table, hash, value, comparator);
+    if (found) return value_at(_CuckooTable_values(table), (size_t) (found - table->slots));
+
+    if (!KeyArena_store_elem(&table->arena, &value, err_code)) return NULL;
+
+    if ((table->size + 1) * CUCKOO_MAX_LOAD_DEN > table->bucket_count * CUCKOO_BUCKET_SIZE * CUCKOO_MAX_LOAD_NUM) {
+        _CuckooTable_rehash(table, table->bucket_count * 2, err_code);
+    }
+
+    size_t slot_id = _CuckooTable_make_room(table, hash);
+
+    //* Unlucky tags may leave no path to an empty slot long before the table is full.
+    while (slot_id == SIZE_MAX) {
+        size_t bucket_count = table->bucket_count;
+
+        _CuckooTable_rehash(table, bucket_count * 2, err_code);
+        _LOG_FAIL_CHECK_(table->bucket_count > bucket_count, "error", ERROR_REPORTS, return NULL, err_code, ENOMEM);
+
+        slot_id = _CuckooTable_make_room(table, hash);
+    }
+
+    table->tags[slot_id] = _CuckooTable_tag(hash);
+    table->slots[slot_id] = value;
+
+    ht_value_t* mapped = value_at(_CuckooTable_values(table), slot_id);
+    memset(mapped, 0, HT_VALUE_SIZE);
+
+    ++table->size;
+
+    return mapped;
+}
+
+bool CuckooTable_erase(CuckooTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(CuckooTable_status(table) == 0, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    HT_ELEM_T* slot = CuckooTable_find_value(table, hash, value, comparator);
+    if (!slot) return false;
+
+    //* Lookups never probe past the candidate buckets, so no tombstone is needed.
+    table->tags[slot - table->slots] = CUCKOO_EMPTY;
+    --table->size;
+
+    if (table->bucket_count > table->min_bucket_count &&
+        table->size * CUCKOO_SHRINK_DIVISOR < table->bucket_count * CUCKOO_BUCKET_SIZE) {
+        _CuckooTable_rehash(table, table->bucket_count / 2, err_code);
+    }
+
+    return true;
+}
+
+HT_ELEM_T* CuckooTable_find_value(const CuckooTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(CuckooTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, NULL, EINVAL);
+
+    uint8_t tag = _CuckooTable_tag(hash);
+    size_t primary = _CuckooTable_primary(table, hash);
+    size_t secondary = _CuckooTable_alternative(table, primary, tag);
+
+    for (unsigned match = _CuckooTable_match(table, primary, secondary, tag); match; match &= match - 1) {
+        HT_ELEM_T* slot = table->slots + _CuckooTable_match_slot(primary, secondary, (unsigned) __builtin_ctz(match));
+        if (elem_equal(*slot, value, comparator)) return slot;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Request tags of both candidate buckets of the group of elements from memory.
+ */
+static void _CuckooTable_prefetch_tags(const CuckooTable* table, const hash_t* hashes, size_t first, size_t count) {
+    for (size_t id = first; id < first + CUCKOO_BATCH_GROUP && id < count; ++id) {
+        size_t primary = _CuckooTable_primary(table, hashes[id]);
+        size_t secondary = _CuckooTable_alternative(table, primary, _CuckooTable_tag(hashes[id]));
+
+        _mm_prefetch((const char*) (table->tags + primary * CUCKOO_BUCKET_SIZE), _MM_HINT_T0);
+        _mm_prefetch((const char*) (table->tags + secondary * CUCKOO_BUCKET_SIZE), _MM_HINT_T0);
+    }
+}
+
+/**
+ * @brief Request the first slot with the matching tag of each element from memory (tags should already be requested).
+ */
+static void _CuckooTable_prefetch_slots(const CuckooTable* table, const hash_t* hashes, size_t first, size_t count) {
+    for (size_t id = first; id < first + CUCKOO_BATCH_GROUP && id < count; ++id) {
+        uint8_t tag = _CuckooTable_tag(hashes[id]);
+        size_t primary = _CuckooTable_primary(table, hashes[id]);
+        size_t secondary = _CuckooTable_alternative(table, primary, tag);
+
+        unsigned match = _CuckooTable_match(table, primary, secondary, tag);
+        if (match) {
+            size_t slot_id = _CuckooTable_match_slot(primary, secondary, (unsigned) __builtin_ctz(match));
+            _mm_prefetch((const char*) (table->slots + slot_id), _MM_HINT_T0);
+        }
+    }
+}
+
+void CuckooTable_find_batch(const CuckooTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                            HT_ELEM_T** results, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(CuckooTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(count == 0 || (hashes && values && results), "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    //* Same three-stage pipeline as the swiss table: tags, then candidate slots, then the lookups themselves.
+    for (size_t group = 0; group < count + 2 * CUCKOO_BATCH_GROUP; group += CUCKOO_BATCH_GROUP) {
+        _CuckooTable_prefetch_tags(table, hashes, group, count);
+
+        if (group >= CUCKOO_BATCH_GROUP) _CuckooTable_prefetch_slots(table, hashes, group - CUCKOO_BATCH_GROUP, count);
+
+        if (group < 2 * CUCKOO_BATCH_GROUP) continue;
+
+        size_t first = group - 2 * CUCKOO_BATCH_GROUP;
+        for (size_t id = first; id < first + CUCKOO_BATCH_GROUP && id < count; ++id) {
+            results[id] = CuckooTable_find_value(table, hashes[id], values[id], comparator);
+        }
+    }
+}
+
+size_t CuckooTable_bucket_count(const CuckooTable* table) {
+    _LOG_FAIL_CHECK_(CuckooTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    return table->bucket_count;
+}
+
+size_t CuckooTable_bucket_size(const CuckooTable* table, size_t bucket_id) {
+    _LOG_FAIL_CHECK_(CuckooTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(bucket_id < table->bucket_count, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    unsigned free_mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_CuckooTable_load_tags(table, bucket_id),
+                                                                     _mm_setzero_si128())) & 0xFF;
+    return CUCKOO_BUCKET_SIZE - (size_t) __builtin_popcount(free_mask);
+}
+
+#endif
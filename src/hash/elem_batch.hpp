@@ -0,0 +1,62 @@
+/**
+ * @file elem_batch.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Hashing of element arrays with batch variants of the hash functions.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef ELEM_BATCH_HPP
+#define ELEM_BATCH_HPP
+
+#include <stddef.h>
+
+#include "src/utils/config.h"
+
+#include "hash_functions.h"
+#include "table_elem.h"
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Calculate hashes of several elements the same way hash_elem does.
+ *
+ * Groups of four short keys go through the batch variant of the function (if it is registered with one),
+ * so their multiplications overlap.
+ *
+ * @param hash registry entry of the hash function (looked up once by the caller)
+ * @param elems elements to hash
+ * @param count number of elements
+ * @param hashes array the hashes are written to
+ */
+void hash_elem_batch(const HashFunctionInfo* hash, const HT_ELEM_T* elems, size_t count, hash_t* hashes);
+
+
+//* IMPLEMENTATIONS ==============================
+
+void hash_elem_batch(const HashFunctionInfo* hash, const HT_ELEM_T* elems, size_t count, hash_t* hashes) {
+    size_t elem_id = 0;
+
+    #if OPTIMIZATION_LEVEL >= 1
+    if (hash->batch) {
+        for (; elem_id + 4 <= count; elem_id += 4) {
+            if (elem_is_long(&elems[elem_id])     || elem_is_long(&elems[elem_id + 1]) ||
+                elem_is_long(&elems[elem_id + 2]) || elem_is_long(&elems[elem_id + 3])) {
+                for (size_t group_id = elem_id; group_id < elem_id + 4; ++group_id) {
+                    hashes[group_id] = hash_elem(hash->function, &elems[group_id]);
+                }
+            } else {
+                hash->batch(elems + elem_id, hashes + elem_id);
+            }
+        }
+    }
+    #endif
+
+    for (; elem_id < count; ++elem_id) hashes[elem_id] = hash_elem(hash->function, &elems[elem_id]);
+}
+
+#endif
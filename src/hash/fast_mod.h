@@ -0,0 +1,69 @@
+/**
+ * @file fast_mod.h
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Division-free modulo by a runtime constant.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef FAST_MOD_H
+#define FAST_MOD_H
+
+#include "hash.h"
+
+/**
+ * @brief Precomputed reduction of hashes modulo a fixed divisor.
+ *
+ * Powers of two are reduced with a mask, other divisors with Lemire's fastmod
+ * (three multiplications instead of a 64-bit division).
+ *
+ * @param divisor
+ * @param mask divisor - 1 if the divisor is a power of two, 0 otherwise
+ * @param multiplier ceil(2^128 / divisor) if the divisor is not a power of two, 0 otherwise
+ */
+struct FastMod {
+    hash_t divisor = 1;
+    hash_t mask = 0;
+    __uint128_t multiplier = 0;
+};
+
+/**
+ * @brief Precompute reduction constants for the divisor.
+ *
+ * @param mod
+ * @param divisor non-zero divisor
+ */
+static inline void FastMod_ctor(FastMod* mod, hash_t divisor) {
+    *mod = {};
+    mod->divisor = divisor;
+
+    if ((divisor & (divisor - 1)) == 0) {
+        mod->mask = divisor - 1;
+        return;
+    }
+
+    mod->multiplier = ~(__uint128_t) 0 / divisor + 1;
+}
+
+/**
+ * @brief Calculate hash % divisor.
+ *
+ * @param mod precomputed reduction constants
+ * @param hash
+ * @return hash_t
+ */
+static inline hash_t FastMod_reduce(const FastMod* mod, hash_t hash) {
+    if (!mod->multiplier) return hash & mod->mask;
+
+    __uint128_t lowbits = mod->multiplier * hash;
+
+    __uint128_t bottom_half = ((lowbits & ~(hash_t) 0) * mod->divisor) >> 64;
+    __uint128_t top_half = (lowbits >> 64) * mod->divisor;
+
+    return (hash_t) ((bottom_half + top_half) >> 64);
+}
+
+#endif
@@ -0,0 +1,415 @@
+/**
+ * @file frozen_table.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Immutable snapshot of a hash table addressed by a minimal perfect hash.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef FROZEN_TABLE_HPP
+#define FROZEN_TABLE_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "src/utils/config.h"
+
+#include "table_elem.h"
+#include "hash_table.hpp"
+#include "key_arena.hpp"
+
+//* Average number of keys sharing a pilot.
+static const size_t FROZEN_BUCKET_SIZE = 4;
+
+//* Pilots are searched among positions of FROZEN_SLOT_DEN / FROZEN_SLOT_NUM times more slots than keys,
+//* positions beyond the key count are then remapped to the free slots.
+static const size_t FROZEN_SLOT_NUM = 49;
+static const size_t FROZEN_SLOT_DEN = 50;
+
+//* Number of times construction is restarted with a new seed if some bucket runs out of pilots.
+static const unsigned FROZEN_MAX_ATTEMPTS = 16;
+
+//* Number of elements batched lookup prefetches pilots ahead (slots are prefetched half as far).
+static const size_t FROZEN_BATCH_DISTANCE = 16;
+
+typedef uint16_t frozen_pilot_t;
+
+typedef unsigned frozen_status_t;
+
+enum FROZEN_STATUS {
+    FROZEN_NULL         = 1 << 0,
+    FROZEN_NO_CONTENT   = 1 << 1,
+};
+
+/**
+ * @brief Read-only table addressed by a minimal perfect hash (PTHash-like "hash and displace" scheme).
+ *
+ * Keys are split into buckets by their hashes, every bucket has a pilot chosen so that the keys
+ * of all buckets get distinct positions. Every key is stored in the dense array at its position,
+ * so a lookup reads a single pilot and a single key.
+ *
+ * @param size number of stored elements
+ * @param bucket_count number of pilots
+ * @param position_count number of positions pilots were searched among (not less than size)
+ * @param seed seed the hashes are mixed with
+ * @param pilots pilot of every bucket
+ * @param remap slots of the positions beyond size (indexed by position - size)
+ * @param keys elements
+ * @param values values of the elements (NULL in set mode)
+ * @param arena storage of the long keys
+ */
+struct FrozenTable {
+    size_t size = 0;
+    size_t bucket_count = 0;
+    size_t position_count = 0;
+    hash_t seed = 0;
+    frozen_pilot_t* pilots = NULL;
+    uint32_t* remap = NULL;
+    HT_ELEM_T* keys = NULL;
+    void* values = NULL;
+    KeyArena arena = {};
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Build frozen snapshot of the table
+ *
+ * The snapshot owns copies of the long keys, but short keys of the unoptimized version
+ * still refer to the memory the table elements refer to.
+ *
+ * @param table table to freeze (should have a hash function, its migration is finished)
+ * @param frozen pointer to the snapshot to construct
+ * @param err_code pointer to the errno-functioning variable
+ */
+void HashTable_freeze(HashTable* table, FrozenTable* frozen, ERROR_MARKER);
+
+/**
+ * @brief Destroy the snapshot
+ *
+ * @param table pointer to the snapshot to destroy
+ */
+void FrozenTable_dtor(FrozenTable* table);
+
+/**
+ * @brief Get status of the snapshot
+ *
+ * @param table pointer to the snapshot
+ * @return frozen_status_t
+ */
+frozen_status_t FrozenTable_status(const FrozenTable* table);
+
+/**
+ * @brief Find element in the snapshot by its hash and value
+ *
+ * The snapshot never changes after construction, so lookups do not validate it.
+ *
+ * @param table snapshot to search in (should be successfully constructed)
+ * @param hash hash of the element
+ * @param value exact value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @return pointer to the element cell (NULL if the element was not found)
+ */
+static inline const HT_ELEM_T* FrozenTable_find_value(const FrozenTable* table, hash_t hash, HT_ELEM_T value,
+                                                      ht_compar_fn_t* comparator);
+
+/**
+ * @brief Find several elements in the snapshot, prefetching their pilots and slots ahead of time
+ *
+ * @param table snapshot to search in
+ * @param hashes hashes of the elements
+ * @param values exact values of the elements
+ * @param count number of elements to search for
+ * @param results array the pointers to the found cells are written to (NULL for absent elements)
+ * @param comparator comparator function between elements (should return 0 on equality)
+ */
+void FrozenTable_find_batch(const FrozenTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                            const HT_ELEM_T** results, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Get the value of the element found in the snapshot
+ *
+ * @param table snapshot
+ * @param cell element cell returned by the lookup
+ * @return pointer to the value of the element
+ */
+static inline const ht_value_t* FrozenTable_value(const FrozenTable* table, const HT_ELEM_T* cell);
+
+/**
+ * @brief Get the number of bytes the snapshot occupies (not counting long keys)
+ *
+ * @param table
+ * @return size_t
+ */
+size_t FrozenTable_footprint(const FrozenTable* table);
+
+
+//* IMPLEMENTATIONS ==============================
+
+//* Finalizer of MurmurHash3, spreads every bit of the input over the whole output.
+static inline uint64_t _FrozenTable_mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDULL;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ULL;
+    return value ^ (value >> 33);
+}
+
+static inline size_t _FrozenTable_range(uint64_t value, size_t range) {
+    return (size_t) (((__uint128_t) value * range) >> 64);
+}
+
+static inline size_t _FrozenTable_bucket(const FrozenTable* table, uint64_t mixed) {
+    return _FrozenTable_range(mixed, table->bucket_count);
+}
+
+static inline size_t _FrozenTable_position(const FrozenTable* table, uint64_t mixed, frozen_pilot_t pilot) {
+    return _FrozenTable_range(_FrozenTable_mix(mixed ^ (pilot * 0x9E3779B97F4A7C15ULL)), table->position_count);
+}
+
+static inline size_t _FrozenTable_slot(const FrozenTable* table, uint64_t mixed) {
+    size_t position = _FrozenTable_position(table, mixed, table->pilots[_FrozenTable_bucket(table, mixed)]);
+    return position < table->size ? position : table->remap[position - table->size];
+}
+
+static inline const HT_ELEM_T* FrozenTable_find_value(const FrozenTable* table, hash_t hash, HT_ELEM_T value,
+                                                      ht_compar_fn_t* comparator) {
+    if (!table->size) return NULL;
+
+    const HT_ELEM_T* cell = &table->keys[_FrozenTable_slot(table, _FrozenTable_mix(hash ^ table->seed))];
+    return elem_equal(*cell, value, comparator) ? cell : NULL;
+}
+
+static inline const ht_value_t* FrozenTable_value(const FrozenTable* table, const HT_ELEM_T* cell) {
+    return value_at(table->values, (size_t) (cell - table->keys));
+}
+
+/**
+ * @brief Find pilots of all buckets.
+ *
+ * @param table snapshot with the sizes and the seed set and pilots allocated
+ * @param mixed mixed hashes of the keys
+ * @param order buffer for the key indices sorted by bucket
+ * @param positions positions of the keys
+ * @param taken buffer for the flags of taken positions
+ * @return false if some bucket has run out of pilots
+ */
+static bool _FrozenTable_place(FrozenTable* table, const uint64_t* mixed, size_t* order, size_t* positions, bool* taken) {
+    size_t* bucket_starts = (size_t*) calloc(table->bucket_count + 1, sizeof(*bucket_starts));
+    size_t* bucket_order = (size_t*) calloc(table->bucket_count, sizeof(*bucket_order));
+    if (!bucket_starts || !bucket_order) {
+        free(bucket_starts);
+        free(bucket_order);
+        return false;
+    }
+
+    //* Keys are counting-sorted by bucket.
+    for (size_t key_id = 0; key_id < table->size; ++key_id) ++bucket_starts[_FrozenTable_bucket(table, mixed[key_id]) + 1];
+    for (size_t bucket_id = 0; bucket_id < table->bucket_count; ++bucket_id) bucket_starts[bucket_id + 1] += bucket_starts[bucket_id];
+
+    for (size_t key_id = 0; key_id < table->size; ++key_id) {
+        order[bucket_starts[_FrozenTable_bucket(table, mixed[key_id])]++] = key_id;
+    }
+
+    for (size_t bucket_id = table->bucket_count; bucket_id > 0; --bucket_id) bucket_starts[bucket_id] = bucket_starts[bucket_id - 1];
+    bucket_starts[0] = 0;
+
+    //* Bigger buckets are placed first, while most of the positions are still free.
+    size_t max_bucket_size = 0;
+    for (size_t bucket_id = 0; bucket_id < table->bucket_count; ++bucket_id) {
+        size_t bucket_size = bucket_starts[bucket_id + 1] - bucket_starts[bucket_id];
+        if (bucket_size > max_bucket_size) max_bucket_size = bucket_size;
+    }
+
+    size_t sorted = 0;
+    for (size_t bucket_size = max_bucket_size; bucket_size > 0; --bucket_size) {
+        for (size_t bucket_id = 0; bucket_id < table->bucket_count; ++bucket_id) {
+            if (bucket_starts[bucket_id + 1] - bucket_starts[bucket_id] == bucket_size) bucket_order[sorted++] = bucket_id;
+        }
+    }
+
+    memset(taken, 0, table->position_count * sizeof(*taken));
+
+    bool placed = true;
+
+    for (size_t sorted_id = 0; placed && sorted_id < sorted; ++sorted_id) {
+        size_t bucket_id = bucket_order[sorted_id];
+        size_t first = bucket_starts[bucket_id], last = bucket_starts[bucket_id + 1];
+
+        placed = false;
+
+        for (uint32_t pilot = 0; !placed && pilot <= UINT16_MAX; ++pilot) {
+            size_t key_id = first;
+
+            for (; key_id < last; ++key_id) {
+                size_t position = _FrozenTable_position(table, mixed[order[key_id]], (frozen_pilot_t) pilot);
+                if (taken[position]) break;
+
+                taken[position] = true;
+                positions[order[key_id]] = position;
+            }
+
+            placed = key_id == last;
+
+            //* Positions of the failed attempt are released.
+            if (!placed) {
+                for (size_t taken_id = first; taken_id < key_id; ++taken_id) taken[positions[order[taken_id]]] = false;
+            } else {
+                table->pilots[bucket_id] = (frozen_pilot_t) pilot;
+            }
+        }
+    }
+
+    free(bucket_starts);
+    free(bucket_order);
+
+    return placed;
+}
+
+void HashTable_freeze(HashTable* table, FrozenTable* frozen, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(table->hash_fn, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(frozen, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(table->size < UINT32_MAX, "error", ERROR_REPORTS, return, err_code, EFBIG);
+
+    *frozen = {};
+
+    _HashTable_migrate(table, table->old_bucket_count, err_code);
+
+    size_t size = table->size;
+
+    frozen->size = size;
+    frozen->bucket_count = size / FROZEN_BUCKET_SIZE + 1;
+    frozen->position_count = size * FROZEN_SLOT_DEN / FROZEN_SLOT_NUM + 1;
+
+    HT_ELEM_T* keys = NULL;
+    int alloc_status = posix_memalign((void**) &keys, 32, (size + 1) * sizeof(*keys));
+    const void** values = (const void**) calloc(size + 1, sizeof(*values));
+    uint64_t* mixed = (uint64_t*) calloc(size + 1, sizeof(*mixed));
+    size_t* order = (size_t*) calloc(size + 1, sizeof(*order));
+    size_t* positions = (size_t*) calloc(size + 1, sizeof(*positions));
+    bool* taken = (bool*) calloc(frozen->position_count, sizeof(*taken));
+
+    frozen->pilots = (frozen_pilot_t*) calloc(frozen->bucket_count, sizeof(*frozen->pilots));
+    frozen->remap = (uint32_t*) calloc(frozen->position_count - size + 1, sizeof(*frozen->remap));
+    alloc_status |= posix_memalign((void**) &frozen->keys, 32, (size + 1) * sizeof(*frozen->keys));
+    if (HT_VALUE_SIZE) frozen->values = calloc(size + 1, HT_VALUE_SIZE);
+
+    bool allocated = alloc_status == 0 && values && mixed && order && positions && taken && frozen->pilots && frozen->remap &&
+                     (frozen->values || !HT_VALUE_SIZE);
+
+    //* Elements are collected along with their values, the order of the elements does not matter.
+    size_t key_id = 0;
+    for (size_t bucket_id = 0; allocated && bucket_id < table->bucket_count; ++bucket_id) {
+        HashBucket* bucket = &table->contents[bucket_id];
+        HT_ELEM_T* bucket_keys = HashBucket_keys(bucket);
+        void* bucket_values = HashBucket_values(bucket);
+
+        for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id, ++key_id) {
+            keys[key_id] = bucket_keys[elem_id];
+            values[key_id] = value_at(bucket_values, elem_id);
+        }
+    }
+
+    bool placed = false;
+    for (unsigned attempt = 0; allocated && !placed && attempt < FROZEN_MAX_ATTEMPTS; ++attempt) {
+        frozen->seed = _FrozenTable_mix(attempt + 1);
+        for (size_t id = 0; id < size; ++id) mixed[id] = _FrozenTable_mix(hash_elem(table->hash_fn, &keys[id]) ^ frozen->seed);
+
+        placed = _FrozenTable_place(frozen, mixed, order, positions, taken);
+    }
+
+    if (placed) {
+        //* Every position beyond the key count leaves a free slot below it.
+        size_t free_slot = 0;
+        for (size_t position = size; position < frozen->position_count; ++position) {
+            if (!taken[position]) continue;
+
+            while (taken[free_slot]) ++free_slot;
+            frozen->remap[position - size] = (uint32_t) free_slot++;
+        }
+
+        for (size_t id = 0; placed && id < size; ++id) {
+            size_t slot = positions[id] < size ? positions[id] : frozen->remap[positions[id] - size];
+
+            frozen->keys[slot] = keys[id];
+            placed = KeyArena_store_elem(&frozen->arena, &frozen->keys[slot], err_code);
+            if (HT_VALUE_SIZE) memcpy(value_at(frozen->values, slot), values[id], HT_VALUE_SIZE);
+        }
+    }
+
+    free(keys);
+    free(values);
+    free(mixed);
+    free(order);
+    free(positions);
+    free(taken);
+
+    _LOG_FAIL_CHECK_(allocated, "error", ERROR_REPORTS, { FrozenTable_dtor(frozen); return; }, err_code, ENOMEM);
+
+    //* Keys with equal hashes can not be separated by any pilot.
+    _LOG_FAIL_CHECK_(placed, "error", ERROR_REPORTS, { FrozenTable_dtor(frozen); return; }, err_code, EINVAL);
+}
+
+void FrozenTable_dtor(FrozenTable* table) {
+    _LOG_FAIL_CHECK_(table, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    free(table->pilots);
+    free(table->remap);
+    free(table->keys);
+    free(table->values);
+
+    KeyArena_dtor(&table->arena);
+
+    *table = {};
+}
+
+frozen_status_t FrozenTable_status(const FrozenTable* table) {
+    if (!table) return FROZEN_NULL;
+    if (!table->pilots || !table->remap || !table->keys) return FROZEN_NO_CONTENT;
+
+    return 0;
+}
+
+void FrozenTable_find_batch(const FrozenTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                            const HT_ELEM_T** results, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(FrozenTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(count == 0 || (hashes && values && results), "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    if (!table->size) {
+        for (size_t id = 0; id < count; ++id) results[id] = NULL;
+        return;
+    }
+
+    //* Pilot of a key is requested first, its slot is requested once the pilot has arrived.
+    for (size_t id = 0; id < count; ++id) {
+        if (id + FROZEN_BATCH_DISTANCE < count) {
+            uint64_t mixed = _FrozenTable_mix(hashes[id + FROZEN_BATCH_DISTANCE] ^ table->seed);
+            _mm_prefetch((const char*) &table->pilots[_FrozenTable_bucket(table, mixed)], _MM_HINT_T0);
+        }
+
+        if (id + FROZEN_BATCH_DISTANCE / 2 < count) {
+            uint64_t mixed = _FrozenTable_mix(hashes[id + FROZEN_BATCH_DISTANCE / 2] ^ table->seed);
+            _mm_prefetch((const char*) &table->keys[_FrozenTable_slot(table, mixed)], _MM_HINT_T0);
+        }
+
+        const HT_ELEM_T* cell = &table->keys[_FrozenTable_slot(table, _FrozenTable_mix(hashes[id] ^ table->seed))];
+        results[id] = elem_equal(*cell, values[id], comparator) ? cell : NULL;
+    }
+}
+
+size_t FrozenTable_footprint(const FrozenTable* table) {
+    _LOG_FAIL_CHECK_(FrozenTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    return sizeof(*table) + table->bucket_count * sizeof(*table->pilots) +
+           (table->position_count - table->size + 1) * sizeof(*table->remap) +
+           (table->size + 1) * (sizeof(*table->keys) + HT_VALUE_SIZE);
+}
+
+#endif
@@ -15,6 +15,15 @@
 typedef unsigned long long hash_t;
 
 typedef hash_t hash_fn_t(const void* begin, const void* end);
+typedef void hash_batch_fn_t(const void* keys, hash_t* hashes);
+
+//* Secret key of the seeded hash functions.
+struct HashSeed {
+    hash_t first;
+    hash_t second;
+};
+
+typedef hash_t seeded_hash_fn_t(const void* begin, const void* end, const HashSeed* seed);
 #define HASH_FUNCTION(name) hash_t name(const void* begin, const void* end)
 
 #endif
@@ -0,0 +1,344 @@
+/**
+ * @file hash_bucket.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Flat bucket of the chained hash table.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef HASH_BUCKET_HPP
+#define HASH_BUCKET_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "src/utils/config.h"
+
+#include "table_elem.h"
+
+//* Fingerprint of the element hash, compared before the element itself.
+typedef uint8_t ht_tag_t;
+
+//* Number of tags compared by a single SIMD instruction. Heap tag storage is padded to a multiple of it.
+static const size_t HT_TAG_BLOCK = 32;
+
+//* Heap capacity of a bucket after its first overflow (heap capacity is always a multiple of it and doubles on growth).
+static const size_t HT_BUCKET_MIN_HEAP = 8;
+
+//* Number of elements stored in the bucket header itself (chosen so the header of a set fills whole cache lines).
+#if OPTIMIZATION_LEVEL < 1
+static const size_t HT_BUCKET_INLINE_SIZE = 4;
+#else
+static const size_t HT_BUCKET_INLINE_SIZE = 3;
+#endif
+
+//* Inline tag storage is padded so the inline elements start at a 32-byte boundary.
+static const size_t HT_BUCKET_INLINE_TAG_COUNT = 8;
+
+typedef unsigned bucket_status_t;
+
+enum BUCKET_STATUS {
+    BUCKET_NULL         = 1 << 0,
+    BUCKET_BIG_SIZE     = 1 << 1,
+};
+
+/**
+ * @brief Bucket storing elements, their values and tags in contiguous arrays.
+ *
+ * First HT_BUCKET_INLINE_SIZE elements are stored inside the bucket, heap storage is only
+ * allocated when they do not fit. Zero-initialized bucket is a valid empty bucket.
+ * Element order is not preserved: removal moves the last element into the freed spot.
+ *
+ * @param keys heap storage of the elements followed by their values and tags (NULL if elements are stored inline)
+ * @param size number of stored elements
+ * @param capacity number of elements heap storage can hold (multiple of HT_BUCKET_MIN_HEAP)
+ * @param inline_tags fingerprints of inline elements
+ * @param inline_keys inline elements
+ * @param inline_values values of inline elements (empty in set mode)
+ */
+struct HashBucket {
+    HT_ELEM_T* keys = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    ht_tag_t inline_tags[HT_BUCKET_INLINE_TAG_COUNT] = {};
+    HT_ELEM_T inline_keys[HT_BUCKET_INLINE_SIZE] = {};
+    alignas(ht_value_t) char inline_values[HT_BUCKET_INLINE_SIZE * HT_VALUE_SIZE] = {};
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Construct empty bucket
+ *
+ * @param bucket pointer to the bucket
+ * @param capacity initial capacity (heap is only allocated if it exceeds HT_BUCKET_INLINE_SIZE)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void HashBucket_ctor(HashBucket* bucket, size_t capacity, ERROR_MARKER);
+
+/**
+ * @brief Destroy the bucket
+ *
+ * @param bucket pointer to the bucket
+ */
+void HashBucket_dtor(HashBucket* bucket);
+
+/**
+ * @brief Get status of the bucket
+ *
+ * @param bucket pointer to the bucket
+ * @return bucket_status_t
+ */
+bucket_status_t HashBucket_status(const HashBucket* bucket);
+
+/**
+ * @brief Move elements of the bucket to heap storage of the specified capacity
+ *
+ * @param bucket pointer to the bucket
+ * @param capacity new capacity (rounded up to a multiple of HT_BUCKET_MIN_HEAP, should fit all elements)
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the bucket was relocated successfully
+ */
+bool HashBucket_reserve(HashBucket* bucket, size_t capacity, ERROR_MARKER);
+
+/**
+ * @brief Get the array of bucket elements
+ *
+ * @param bucket pointer to the bucket
+ * @return HT_ELEM_T*
+ */
+static inline HT_ELEM_T* HashBucket_keys(HashBucket* bucket) {
+    return bucket->keys ? bucket->keys : bucket->inline_keys;
+}
+
+/**
+ * @brief Get the array of bucket element values
+ *
+ * @param bucket pointer to the bucket
+ * @return pointer to the values (should be accessed through value_at())
+ */
+static inline void* HashBucket_values(HashBucket* bucket) {
+    return bucket->keys ? (void*) (bucket->keys + bucket->capacity) : (void*) bucket->inline_values;
+}
+
+/**
+ * @brief Get the array of bucket element tags
+ *
+ * @param bucket pointer to the bucket
+ * @return ht_tag_t*
+ */
+static inline ht_tag_t* HashBucket_tags(HashBucket* bucket) {
+    if (!bucket->keys) return bucket->inline_tags;
+    return (ht_tag_t*) ((char*) (bucket->keys + bucket->capacity) + bucket->capacity * HT_VALUE_SIZE);
+}
+
+/**
+ * @brief Get the number of elements the bucket can hold without relocation
+ *
+ * @param bucket pointer to the bucket
+ * @return size_t
+ */
+static inline size_t HashBucket_capacity(const HashBucket* bucket) {
+    return bucket->keys ? bucket->capacity : HT_BUCKET_INLINE_SIZE;
+}
+
+/**
+ * @brief Get the number of bytes the heap storage of the bucket occupies
+ *
+ * @param bucket pointer to the bucket
+ * @return size_t
+ */
+static inline size_t HashBucket_heap_size(const HashBucket* bucket) {
+    if (!bucket->keys) return 0;
+
+    size_t tag_count = (bucket->capacity + HT_TAG_BLOCK - 1) / HT_TAG_BLOCK * HT_TAG_BLOCK;
+    return bucket->capacity * (sizeof(HT_ELEM_T) + HT_VALUE_SIZE) + tag_count * sizeof(ht_tag_t);
+}
+
+/**
+ * @brief Append element to the bucket
+ *
+ * @param bucket pointer to the bucket
+ * @param value element to append
+ * @param tag fingerprint of the element
+ * @param err_code pointer to the errno-functioning variable
+ * @return zero-initialized value of the element (NULL on failure)
+ */
+ht_value_t* HashBucket_push(HashBucket* bucket, HT_ELEM_T value, ht_tag_t tag, ERROR_MARKER);
+
+/**
+ * @brief Remove element from the bucket by replacing it with the last one
+ *
+ * @param bucket pointer to the bucket
+ * @param index index of the element
+ */
+void HashBucket_remove(HashBucket* bucket, size_t index);
+
+/**
+ * @brief Release storage the bucket does not need anymore
+ *
+ * Heap storage that is at most a quarter full is halved, elements that fit the bucket header are moved back inline.
+ *
+ * @param bucket pointer to the bucket
+ * @param err_code pointer to the errno-functioning variable
+ */
+void HashBucket_shrink(HashBucket* bucket, ERROR_MARKER);
+
+/**
+ * @brief Find element in the bucket
+ *
+ * @param bucket pointer to the bucket
+ * @param value exact value of the element
+ * @param tag fingerprint of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @return pointer to the element (NULL if the element was not found)
+ */
+HT_ELEM_T* HashBucket_find(HashBucket* bucket, HT_ELEM_T value, ht_tag_t tag, ht_compar_fn_t* comparator);
+
+
+//* IMPLEMENTATIONS ==============================
+
+void HashBucket_ctor(HashBucket* bucket, size_t capacity, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(bucket, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *bucket = {};
+    if (capacity > HT_BUCKET_INLINE_SIZE) HashBucket_reserve(bucket, capacity, err_code);
+}
+
+void HashBucket_dtor(HashBucket* bucket) {
+    _LOG_FAIL_CHECK_(bucket, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    free(bucket->keys);
+
+    *bucket = {};
+}
+
+bucket_status_t HashBucket_status(const HashBucket* bucket) {
+    if (!bucket) return BUCKET_NULL;
+    if (bucket->size > HashBucket_capacity(bucket)) return BUCKET_BIG_SIZE;
+
+    return 0;
+}
+
+bool HashBucket_reserve(HashBucket* bucket, size_t capacity, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(bucket, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(capacity >= bucket->size, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    capacity = (capacity + HT_BUCKET_MIN_HEAP - 1) / HT_BUCKET_MIN_HEAP * HT_BUCKET_MIN_HEAP;
+    if (capacity == 0) capacity = HT_BUCKET_MIN_HEAP;
+
+    //* Values and tags are stored right after the elements, so the whole bucket takes a single allocation.
+    //* Tags are padded to a whole block, so the lookup can load the last block without reading past the allocation.
+    size_t tag_count = (capacity + HT_TAG_BLOCK - 1) / HT_TAG_BLOCK * HT_TAG_BLOCK;
+
+    HT_ELEM_T* new_keys = NULL;
+    int alloc_status = posix_memalign((void**) &new_keys, 32,
+                                      capacity * (sizeof(HT_ELEM_T) + HT_VALUE_SIZE) + tag_count * sizeof(ht_tag_t));
+    _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, return false, err_code, ENOMEM);
+
+    void* new_values = new_keys + capacity;
+    ht_tag_t* new_tags = (ht_tag_t*) ((char*) new_values + capacity * HT_VALUE_SIZE);
+
+    if (bucket->size) {
+        memcpy(new_keys, HashBucket_keys(bucket), bucket->size * sizeof(*new_keys));
+        memcpy(new_values, HashBucket_values(bucket), bucket->size * HT_VALUE_SIZE);
+        memcpy(new_tags, HashBucket_tags(bucket), bucket->size * sizeof(*new_tags));
+    }
+
+    free(bucket->keys);
+
+    bucket->keys = new_keys;
+    bucket->capacity = capacity;
+
+    return true;
+}
+
+ht_value_t* HashBucket_push(HashBucket* bucket, HT_ELEM_T value, ht_tag_t tag, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(HashBucket_status(bucket) == 0, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+
+    if (bucket->size == HashBucket_capacity(bucket) &&
+        !HashBucket_reserve(bucket, bucket->keys ? bucket->capacity * 2 : HT_BUCKET_MIN_HEAP, err_code)) return NULL;
+
+    ht_value_t* mapped = value_at(HashBucket_values(bucket), bucket->size);
+    memset(mapped, 0, HT_VALUE_SIZE);
+
+    HashBucket_keys(bucket)[bucket->size] = value;
+    HashBucket_tags(bucket)[bucket->size] = tag;
+    ++bucket->size;
+
+    return mapped;
+}
+
+void HashBucket_remove(HashBucket* bucket, size_t index) {
+    _LOG_FAIL_CHECK_(HashBucket_status(bucket) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(index < bucket->size, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    --bucket->size;
+
+    void* values = HashBucket_values(bucket);
+
+    HashBucket_keys(bucket)[index] = HashBucket_keys(bucket)[bucket->size];
+    memmove(value_at(values, index), value_at(values, bucket->size), HT_VALUE_SIZE);
+    HashBucket_tags(bucket)[index] = HashBucket_tags(bucket)[bucket->size];
+}
+
+void HashBucket_shrink(HashBucket* bucket, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(HashBucket_status(bucket) == 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    if (!bucket->keys || bucket->size * 4 > bucket->capacity) return;
+
+    if (bucket->size <= HT_BUCKET_INLINE_SIZE) {
+        HT_ELEM_T* keys = bucket->keys;
+
+        memcpy(bucket->inline_keys, keys, bucket->size * sizeof(*keys));
+        memcpy(bucket->inline_values, HashBucket_values(bucket), bucket->size * HT_VALUE_SIZE);
+        memcpy(bucket->inline_tags, HashBucket_tags(bucket), bucket->size * sizeof(*bucket->inline_tags));
+
+        bucket->keys = NULL;
+        bucket->capacity = 0;
+        free(keys);
+
+        return;
+    }
+
+    if (bucket->capacity > HT_BUCKET_MIN_HEAP) HashBucket_reserve(bucket, bucket->capacity / 2, err_code);
+}
+
+HT_ELEM_T* HashBucket_find(HashBucket* bucket, HT_ELEM_T value, ht_tag_t tag, ht_compar_fn_t* comparator) {
+    if (!bucket->keys) {
+        for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id) {
+            if (bucket->inline_tags[elem_id] == tag &&
+                elem_equal(bucket->inline_keys[elem_id], value, comparator)) return &bucket->inline_keys[elem_id];
+        }
+
+        return NULL;
+    }
+
+    ht_tag_t* tag_array = HashBucket_tags(bucket);
+    __m256i tag_pattern = _mm256_set1_epi8((char) tag);
+
+    //* Elements are only compared if their tags match, so most misses never touch the elements.
+    //* Tags past the size of the bucket are masked out (small heaps do not keep their tags 32-byte aligned).
+    for (size_t block = 0; block < bucket->size; block += HT_TAG_BLOCK) {
+        __m256i tags = _mm256_loadu_si256((const __m256i*) (tag_array + block));
+        unsigned match = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(tags, tag_pattern));
+
+        size_t tags_left = bucket->size - block;
+        if (tags_left < HT_TAG_BLOCK) match &= (1u << tags_left) - 1;
+
+        for (; match; match &= match - 1) {
+            HT_ELEM_T* key = &bucket->keys[block + (size_t) __builtin_ctz(match)];
+
+            if (elem_equal(*key, value, comparator)) return key;
+        }
+    }
+
+    return NULL;
+}
+
+#endif
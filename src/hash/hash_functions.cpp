@@ -4,6 +4,7 @@
 #include <inttypes.h>
 #include <x86intrin.h>
 #include <math.h>
+#include <sys/random.h>
 
 #include "lib/util/dbg/debug.h"
 #include "src/utils/config.h"
@@ -115,3 +116,245 @@ asm(R"(  jb      .LBB0_2)"                      "\n");
 asm(R"(.LBB0_3:"                                "\n");
 asm(R"(  retq)"                                 "\n");
 #endif
+
+hash_t crc32_hash(const void* begin, const void* end) {
+    const char* ptr = (const char*) begin;
+    size_t length = (size_t) ((const char*) end - ptr);
+
+    unsigned long long crc = 0xFFFFFFFF;
+
+    //* Fixed-size keys take four dependent crc32 instructions.
+    if (length == MAX_WORD_LENGTH) {
+        hash_t words[4] = {};
+        memcpy(words, ptr, sizeof(words));
+
+        crc = _mm_crc32_u64(crc, words[0]);
+        crc = _mm_crc32_u64(crc, words[1]);
+        crc = _mm_crc32_u64(crc, words[2]);
+        crc = _mm_crc32_u64(crc, words[3]);
+    } else {
+        for (; length >= sizeof(hash_t); ptr += sizeof(hash_t), length -= sizeof(hash_t)) {
+            hash_t word = 0;
+            memcpy(&word, ptr, sizeof(word));
+            crc = _mm_crc32_u64(crc, word);
+        }
+
+        for (; length > 0; ++ptr, --length) crc = _mm_crc32_u8((unsigned) crc, (unsigned char) *ptr);
+    }
+
+    //* CRC is only 32 bits wide, the multiplication spreads it over the upper half tables take their tags from.
+    return crc * 0x9E3779B97F4A7C15ULL;
+}
+
+//* Folding the lanes with xor cancels equal columns of the state (keys repeating a 4-byte block all collide),
+//* so the upper lane is multiplied in and the result goes through the murmur3 64-bit finalizer.
+static inline hash_t aes_finalize(__m128i state) {
+    hash_t low  = (hash_t) _mm_cvtsi128_si64(state);
+    hash_t high = (hash_t) _mm_cvtsi128_si64(_mm_unpackhi_epi64(state, state));
+
+    hash_t value = low ^ high * 0x9E3779B97F4A7C15ULL;
+
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDULL;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ULL;
+    value ^= value >> 33;
+
+    return value;
+}
+
+//* The build targets processors with AVX2, all of which have AES-NI as well.
+__attribute__((__target__("aes")))
+hash_t aes_hash(const void* begin, const void* end) {
+    const char* ptr = (const char*) begin;
+    size_t length = (size_t) ((const char*) end - ptr);
+
+    const __m128i round_key = _mm_set_epi64x((long long) length, 0x243F6A8885A308D3);
+
+    //* Two rounds spread every byte of the block over the whole state, so blocks are only combined after two rounds.
+    //* Fixed-size keys hash their halves in parallel under different keys (equal halves must not cancel out).
+    if (length == MAX_WORD_LENGTH) {
+        const __m128i half_key = _mm_set_epi64x((long long) length, 0x13198A2E03707344);
+
+        __m128i low  = _mm_xor_si128(_mm_loadu_si128((const __m128i*) ptr),     round_key);
+        __m128i high = _mm_xor_si128(_mm_loadu_si128((const __m128i*) ptr + 1), half_key);
+
+        low  = _mm_aesenc_si128(_mm_aesenc_si128(low,  round_key), round_key);
+        high = _mm_aesenc_si128(_mm_aesenc_si128(high, half_key),  half_key);
+
+        return aes_finalize(_mm_xor_si128(low, high));
+    }
+
+    __m128i state = round_key;
+
+    for (; length >= sizeof(state); ptr += sizeof(state), length -= sizeof(state)) {
+        state = _mm_xor_si128(state, _mm_loadu_si128((const __m128i*) ptr));
+        state = _mm_aesenc_si128(_mm_aesenc_si128(state, round_key), round_key);
+    }
+
+    if (length > 0) {
+        __m128i block = _mm_setzero_si128();
+        memcpy(&block, ptr, length);
+
+        state = _mm_aesenc_si128(_mm_aesenc_si128(_mm_xor_si128(state, block), round_key), round_key);
+    }
+
+    return aes_finalize(state);
+}
+
+static const size_t SIP_COMPRESSION_ROUNDS = 1;
+static const size_t SIP_FINALIZATION_ROUNDS = 3;
+
+static inline void sip_round(hash_t* state) {
+    state[0] += state[1]; state[1] = cycle_left(state[1], 13); state[1] ^= state[0]; state[0] = cycle_left(state[0], 32);
+    state[2] += state[3]; state[3] = cycle_left(state[3], 16); state[3] ^= state[2];
+    state[0] += state[3]; state[3] = cycle_left(state[3], 21); state[3] ^= state[0];
+    state[2] += state[1]; state[1] = cycle_left(state[1], 17); state[1] ^= state[2]; state[2] = cycle_left(state[2], 32);
+}
+
+static inline void sip_compress(hash_t* state, hash_t word) {
+    state[3] ^= word;
+    for (size_t round = 0; round < SIP_COMPRESSION_ROUNDS; ++round) sip_round(state);
+    state[0] ^= word;
+}
+
+hash_t sip_hash(const void* begin, const void* end, const HashSeed* seed) {
+    const char* ptr = (const char*) begin;
+    size_t length = (size_t) ((const char*) end - ptr);
+
+    hash_t state[4] = { seed->first  ^ 0x736F6D6570736575ULL, seed->second ^ 0x646F72616E646F6DULL,
+                        seed->first  ^ 0x6C7967656E657261ULL, seed->second ^ 0x7465646279746573ULL };
+
+    for (size_t left = length; left >= sizeof(hash_t); ptr += sizeof(hash_t), left -= sizeof(hash_t)) {
+        hash_t word = 0;
+        memcpy(&word, ptr, sizeof(word));
+        sip_compress(state, word);
+    }
+
+    //* The last word holds the remaining bytes and the length of the key in its top byte.
+    hash_t last_word = 0;
+    memcpy(&last_word, ptr, length % sizeof(hash_t));
+    sip_compress(state, last_word | (hash_t) length << 56);
+
+    state[2] ^= 0xFF;
+    for (size_t round = 0; round < SIP_FINALIZATION_ROUNDS; ++round) sip_round(state);
+
+    return state[0] ^ state[1] ^ state[2] ^ state[3];
+}
+
+void hash_seed_draw(HashSeed* seed, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(seed, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    ssize_t drawn = getrandom(seed, sizeof(*seed), 0);
+
+    //* Time stamp counter is only a fallback, its values can be guessed.
+    _LOG_FAIL_CHECK_(drawn == (ssize_t) sizeof(*seed), "error", ERROR_REPORTS, {
+        seed->first  = cycle_left(__rdtsc() * 0x9E3779B97F4A7C15ULL, 29);
+        seed->second = cycle_left(__rdtsc() * 0xBF58476D1CE4E5B9ULL, 31);
+    }, err_code, EAGAIN);
+}
+
+//* Every lane of the vector carries its own key. AVX2 has no full 64-bit multiplication, so lanes are multiplied
+//* by 32-bit factors in two parts: the low half with a widening multiplication and the high half with a 32-bit one,
+//* which only needs the factor to be moved to the upper half of the lane (factor_high).
+static inline __m256i multiply_x4(__m256i num, __m256i factor, __m256i factor_high) {
+    return _mm256_add_epi64(_mm256_mul_epu32(num, factor), _mm256_mullo_epi32(num, factor_high));
+}
+
+static inline __m256i cycle_left_x4(__m256i num, int shift) {
+    return _mm256_or_si256(_mm256_slli_epi64(num, shift), _mm256_srli_epi64(num, 64 - shift));
+}
+
+static_assert(MAX_WORD_LENGTH == 4 * sizeof(hash_t), "murmur_hash_x4 expects keys of four words");
+
+//* Keys are transposed, so the i-th vector holds the i-th words of all four keys.
+static inline void transpose_x4(const void* keys, __m256i* segments) {
+    const __m256i* key_vectors = (const __m256i*) keys;
+
+    __m256i alpha = _mm256_loadu_si256(key_vectors + 0), beta  = _mm256_loadu_si256(key_vectors + 1);
+    __m256i gamma = _mm256_loadu_si256(key_vectors + 2), delta = _mm256_loadu_si256(key_vectors + 3);
+
+    __m256i even_low = _mm256_unpacklo_epi64(alpha, beta), odd_low = _mm256_unpackhi_epi64(alpha, beta);
+    __m256i even_high = _mm256_unpacklo_epi64(gamma, delta), odd_high = _mm256_unpackhi_epi64(gamma, delta);
+
+    segments[0] = _mm256_permute2x128_si256(even_low, even_high, 0x20);
+    segments[1] = _mm256_permute2x128_si256(odd_low, odd_high, 0x20);
+    segments[2] = _mm256_permute2x128_si256(even_low, even_high, 0x31);
+    segments[3] = _mm256_permute2x128_si256(odd_low, odd_high, 0x31);
+}
+
+static void murmur_hash_x4_avx2(const void* keys, hash_t* hashes) {
+    __m256i segments[4] = {};
+    transpose_x4(keys, segments);
+
+    const __m256i first_factor = _mm256_set1_epi64x(0xDED15DED), first_high = _mm256_slli_epi64(first_factor, 32);
+    const __m256i second_factor = _mm256_set1_epi64x(0xCADAB8A9), second_high = _mm256_slli_epi64(second_factor, 32);
+    const __m256i third_factor = _mm256_set1_epi64x(0x112C13AB), third_high = _mm256_slli_epi64(third_factor, 32);
+    const __m256i offset = _mm256_set1_epi64x(0x314159265358979);
+
+    __m256i value = _mm256_set1_epi64x((long long) 0xBAADF00DDEADBEEF);
+
+    for (size_t segment_id = 0; segment_id < 4; ++segment_id) {
+        __m256i current = multiply_x4(segments[segment_id], first_factor, first_high);
+        current = multiply_x4(cycle_left_x4(current, 31), second_factor, second_high);
+        current = _mm256_xor_si256(current, value);
+        value = _mm256_add_epi64(multiply_x4(cycle_left_x4(current, 15), third_factor, third_high), offset);
+    }
+
+    _mm256_storeu_si256((__m256i*) hashes, value);
+}
+
+//* AVX-512 multiplies and rotates 64-bit lanes with single instructions.
+__attribute__((__target__("avx512vl,avx512dq")))
+static void murmur_hash_x4_avx512(const void* keys, hash_t* hashes) {
+    __m256i segments[4] = {};
+    transpose_x4(keys, segments);
+
+    const __m256i first_factor = _mm256_set1_epi64x(0xDED15DED);
+    const __m256i second_factor = _mm256_set1_epi64x(0xCADAB8A9);
+    const __m256i third_factor = _mm256_set1_epi64x(0x112C13AB);
+    const __m256i offset = _mm256_set1_epi64x(0x314159265358979);
+
+    __m256i value = _mm256_set1_epi64x((long long) 0xBAADF00DDEADBEEF);
+
+    for (size_t segment_id = 0; segment_id < 4; ++segment_id) {
+        __m256i current = _mm256_mullo_epi64(_mm256_rol_epi64(_mm256_mullo_epi64(segments[segment_id], first_factor), 31),
+                                             second_factor);
+        current = _mm256_xor_si256(current, value);
+        value = _mm256_add_epi64(_mm256_mullo_epi64(_mm256_rol_epi64(current, 15), third_factor), offset);
+    }
+
+    _mm256_storeu_si256((__m256i*) hashes, value);
+}
+
+static hash_batch_fn_t* pick_murmur_hash_x4() {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq")) return murmur_hash_x4_avx512;
+    return murmur_hash_x4_avx2;
+}
+
+void murmur_hash_x4(const void* keys, hash_t* hashes) {
+    static hash_batch_fn_t* const kernel = pick_murmur_hash_x4();
+    kernel(keys, hashes);
+}
+
+#define _HASH_INFO_ENTRY(function, batch, key_types) { #function, function, batch, key_types },
+const HashFunctionInfo HASH_FUNCTIONS[HASH_FUNCTION_COUNT] = { HASH_FUNCTION_LIST(_HASH_INFO_ENTRY) };
+#undef _HASH_INFO_ENTRY
+
+const HashFunctionInfo* find_hash_function(const char* name) {
+    for (size_t hash_id = 0; hash_id < HASH_FUNCTION_COUNT; ++hash_id) {
+        if (strcmp(HASH_FUNCTIONS[hash_id].name, name) == 0) return &HASH_FUNCTIONS[hash_id];
+    }
+
+    return NULL;
+}
+
+const HashFunctionInfo* find_hash_function(hash_fn_t* function) {
+    for (size_t hash_id = 0; hash_id < HASH_FUNCTION_COUNT; ++hash_id) {
+        if (HASH_FUNCTIONS[hash_id].function == function) return &HASH_FUNCTIONS[hash_id];
+    }
+
+    return NULL;
+}
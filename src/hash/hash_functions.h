@@ -12,8 +12,11 @@
 #ifndef HASH_FUNCTIONS_H
 #define HASH_FUNCTIONS_H
 
+#include <stddef.h>
+
 #include "hash.h"
 
+#include "lib/util/dbg/debug.h"
 #include "src/utils/config.h"
 
 hash_t ident_hash       (const void* begin, const void* end);
@@ -29,10 +32,107 @@ hash_t right_shift_hash (const void* begin, const void* end);
 
 hash_t poly_hash        (const void* begin, const void* end);
 
+hash_t crc32_hash       (const void* begin, const void* end);
+hash_t aes_hash         (const void* begin, const void* end);
+
 #if OPTIMIZATION_LEVEL < 2
 hash_t murmur_hash      (const void* begin, const void* end);
 #else
 extern hash_t murmur_hash(const void* begin, const void* end);
 #endif
 
+/**
+ * @brief Hash four MAX_WORD_LENGTH-byte keys at once, one key per vector lane (same results as murmur_hash).
+ *
+ * AVX-512 version is used if the processor supports it, AVX2 version otherwise.
+ *
+ * @param keys four keys laid out one after another
+ * @param hashes array the four hashes are written to
+ */
+void murmur_hash_x4(const void* keys, hash_t* hashes);
+
+/**
+ * @brief SipHash-1-3 of the key under the seed.
+ *
+ * Hashes of other keys do not tell anything about the hashes under an unknown seed,
+ * so keys colliding in a table can not be picked in advance.
+ *
+ * @param begin
+ * @param end
+ * @param seed secret key of the function
+ * @return hash_t
+ */
+hash_t sip_hash(const void* begin, const void* end, const HashSeed* seed);
+
+/**
+ * @brief Draw random seed for the seeded hash functions
+ *
+ * @param seed
+ * @param err_code pointer to the errno-functioning variable
+ */
+void hash_seed_draw(HashSeed* seed, ERROR_MARKER);
+
+//* Kinds of keys a hash function is meant for.
+enum HASH_KEY_TYPE {
+    HASH_KEY_INT    = 1 << 0,
+    HASH_KEY_DOUBLE = 1 << 1,
+    HASH_KEY_STRING = 1 << 2,
+};
+
+static const unsigned HASH_KEY_ANY = HASH_KEY_INT | HASH_KEY_DOUBLE | HASH_KEY_STRING;
+
+//* Every hash function of the module as HASH_ENTRY(function, batch variant or NULL, supported key types).
+//* Expanding the list with a custom HASH_ENTRY gives code with a direct call to each of the functions.
+#define HASH_FUNCTION_LIST(HASH_ENTRY)                                              \
+    HASH_ENTRY(ident_hash,          NULL,           HASH_KEY_INT | HASH_KEY_DOUBLE) \
+    HASH_ENTRY(mult_hash,           NULL,           HASH_KEY_INT | HASH_KEY_DOUBLE) \
+    HASH_ENTRY(floor_hash,          NULL,           HASH_KEY_DOUBLE)                \
+    HASH_ENTRY(constant_hash,       NULL,           HASH_KEY_ANY)                   \
+    HASH_ENTRY(first_char_hash,     NULL,           HASH_KEY_STRING)                \
+    HASH_ENTRY(length_hash,         NULL,           HASH_KEY_STRING)                \
+    HASH_ENTRY(sum_hash,            NULL,           HASH_KEY_STRING)                \
+    HASH_ENTRY(left_shift_hash,     NULL,           HASH_KEY_STRING)                \
+    HASH_ENTRY(right_shift_hash,    NULL,           HASH_KEY_STRING)                \
+    HASH_ENTRY(poly_hash,           NULL,           HASH_KEY_STRING)                \
+    HASH_ENTRY(crc32_hash,          NULL,           HASH_KEY_ANY)                   \
+    HASH_ENTRY(aes_hash,            NULL,           HASH_KEY_ANY)                   \
+    HASH_ENTRY(murmur_hash,         murmur_hash_x4, HASH_KEY_ANY)
+
+/**
+ * @brief Registry entry of the hash function.
+ *
+ * @param name name of the function
+ * @param function the function itself
+ * @param batch function hashing four MAX_WORD_LENGTH-byte keys at once with the same results (NULL if there is none)
+ * @param key_types kinds of keys the function is meant for (HASH_KEY_TYPE mask)
+ */
+struct HashFunctionInfo {
+    const char* name;
+    hash_fn_t* function;
+    hash_batch_fn_t* batch;
+    unsigned key_types;
+};
+
+#define _HASH_COUNT_ENTRY(function, batch, key_types) + 1
+static const size_t HASH_FUNCTION_COUNT = 0 HASH_FUNCTION_LIST(_HASH_COUNT_ENTRY);
+#undef _HASH_COUNT_ENTRY
+
+extern const HashFunctionInfo HASH_FUNCTIONS[HASH_FUNCTION_COUNT];
+
+/**
+ * @brief Find registered hash function by its name
+ *
+ * @param name
+ * @return registry entry of the function (NULL if there is no such function)
+ */
+const HashFunctionInfo* find_hash_function(const char* name);
+
+/**
+ * @brief Find registry entry of the hash function
+ *
+ * @param function
+ * @return registry entry of the function (NULL if the function is not registered)
+ */
+const HashFunctionInfo* find_hash_function(hash_fn_t* function);
+
 #endif
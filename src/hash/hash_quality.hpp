@@ -0,0 +1,425 @@
+/**
+ * @file hash_quality.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Quality and speed tests of hash functions in the spirit of SMHasher.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef HASH_QUALITY_HPP
+#define HASH_QUALITY_HPP
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "lib/util/dbg/debug.h"
+#include "src/utils/config.h"
+
+#include "hash.h"
+
+//* Keys are filled from a fixed seed, so every run tests the functions on the same keys.
+static const uint64_t QUALITY_SEED = 0x5EED5EED5EED5EEDULL;
+
+//* Keys of the quality tests have the size of the keys the tables store.
+static const size_t QUALITY_KEY_LENGTH = MAX_WORD_LENGTH;
+static const size_t QUALITY_KEY_BITS = QUALITY_KEY_LENGTH * 8;
+static const size_t QUALITY_HASH_BITS = sizeof(hash_t) * 8;
+
+//* Number of random keys every input bit is flipped in by the avalanche and bit independence tests.
+static const size_t QUALITY_AVALANCHE_SAMPLE_COUNT = 10000;
+static const size_t QUALITY_BIC_SAMPLE_COUNT = 2000;
+
+//* Number of keys of the random and cyclic collision tests (sparse keys are all keys with at most 3 bits set).
+static const size_t QUALITY_COLLISION_KEY_COUNT = 1 << 20;
+static const size_t QUALITY_SPARSE_MAX_BITS = 3;
+
+//* Speed is measured on QUALITY_SPEED_KEY_COUNT keys of every small length and on keys of the bulk length,
+//* the fastest of QUALITY_SPEED_TRIAL_COUNT trials is taken. Lengths are multiples of 8, as some functions read words.
+static const size_t QUALITY_SMALL_LENGTHS[] = { 8, 16, 32 };
+static const size_t QUALITY_SMALL_LENGTH_COUNT = sizeof(QUALITY_SMALL_LENGTHS) / sizeof(*QUALITY_SMALL_LENGTHS);
+static const size_t QUALITY_BULK_LENGTH = 1024;
+static const size_t QUALITY_SPEED_KEY_COUNT = 1024;
+static const size_t QUALITY_SPEED_TRIAL_COUNT = 256;
+
+/**
+ * @brief Collisions of the hashes of a set of distinct keys.
+ *
+ * @param key_count number of keys
+ * @param collisions number of keys with the same full hash as some key before them
+ * @param low_collisions the same for the lower 32 bits of the hashes
+ * @param high_collisions the same for the upper 32 bits of the hashes
+ * @param expected_collisions number of 32-bit collisions an ideal function would give
+ */
+struct HashCollisionReport {
+    size_t key_count = 0;
+    size_t collisions = 0;
+    size_t low_collisions = 0;
+    size_t high_collisions = 0;
+    double expected_collisions = 0.0;
+};
+
+/**
+ * @brief Results of the quality suite for a single hash function.
+ *
+ * Biases lie between 0 (ideal) and 1 (output does not depend on the input or is fully correlated).
+ *
+ * @param avalanche_bias worst |2 P(output bit flips) - 1| over pairs of input and output bits
+ * @param bic_bias worst correlation between flips of two output bits caused by the same input bit
+ * @param random collisions of random keys
+ * @param sparse collisions of keys with few bits set
+ * @param cyclic collisions of keys made of a repeated 4-byte block
+ * @param cycles_per_hash time stamp counter cycles per hash of the keys of QUALITY_SMALL_LENGTHS
+ * @param cycles_per_byte time stamp counter cycles per byte of QUALITY_BULK_LENGTH-byte keys
+ */
+struct HashQualityReport {
+    double avalanche_bias = 0.0;
+    double bic_bias = 0.0;
+    HashCollisionReport random = {};
+    HashCollisionReport sparse = {};
+    HashCollisionReport cyclic = {};
+    double cycles_per_hash[QUALITY_SMALL_LENGTH_COUNT] = {};
+    double cycles_per_byte = 0.0;
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Run avalanche, bit independence and collision tests of the function
+ *
+ * @param report report to write the results to
+ * @param hash_fn tested function
+ * @param err_code pointer to the errno-functioning variable
+ */
+void HashQuality_test(HashQualityReport* report, hash_fn_t* hash_fn, ERROR_MARKER);
+
+/**
+ * @brief Measure speed of the function
+ *
+ * @tparam hash_fn tested function (a template parameter, so the measured loop calls it directly)
+ * @param report report to write the results to
+ * @param err_code pointer to the errno-functioning variable
+ */
+template <hash_fn_t* hash_fn>
+void HashQuality_measure_speed(HashQualityReport* report, ERROR_MARKER);
+
+/**
+ * @brief Print CSV header of the reports
+ *
+ * @param file
+ */
+void HashQuality_print_header(FILE* file);
+
+/**
+ * @brief Print the report as a CSV line
+ *
+ * @param file
+ * @param name name of the function
+ * @param report
+ */
+void HashQuality_print(FILE* file, const char* name, const HashQualityReport* report);
+
+
+//* IMPLEMENTATIONS ==============================
+
+//* SplitMix64 generator, the keys should not depend on the rand() implementation.
+static inline uint64_t _HashQuality_random(uint64_t* state) {
+    uint64_t value = (*state += 0x9E3779B97F4A7C15ULL);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+static inline void _HashQuality_fill(void* key, size_t length, uint64_t* state) {
+    for (size_t offset = 0; offset < length; offset += sizeof(uint64_t)) {
+        uint64_t word = _HashQuality_random(state);
+        memcpy((char*) key + offset, &word, length - offset < sizeof(word) ? length - offset : sizeof(word));
+    }
+}
+
+static inline hash_t _HashQuality_hash(hash_fn_t* hash_fn, const char* key) {
+    return hash_fn(key, key + QUALITY_KEY_LENGTH);
+}
+
+static inline void _HashQuality_flip(char* key, size_t bit_id) {
+    key[bit_id / 8] = (char) (key[bit_id / 8] ^ (1 << (bit_id % 8)));
+}
+
+static int _HashQuality_compare(const void* alpha, const void* beta) {
+    hash_t alpha_hash = *(const hash_t*) alpha;
+    hash_t beta_hash = *(const hash_t*) beta;
+    return (alpha_hash > beta_hash) - (alpha_hash < beta_hash);
+}
+
+static size_t _HashQuality_count_collisions(hash_t* hashes, size_t count, hash_t mask, unsigned shift) {
+    for (size_t hash_id = 0; hash_id < count; ++hash_id) hashes[hash_id] = (hashes[hash_id] >> shift) & mask;
+
+    qsort(hashes, count, sizeof(*hashes), _HashQuality_compare);
+
+    size_t collisions = 0;
+    for (size_t hash_id = 1; hash_id < count; ++hash_id) collisions += hashes[hash_id] == hashes[hash_id - 1];
+
+    return collisions;
+}
+
+//* Collisions are counted for the full hash, then for its halves (hashes are restored from the copy in between).
+static void _HashQuality_collisions(HashCollisionReport* report, const hash_t* hashes, hash_t* buffer, size_t count) {
+    report->key_count = count;
+
+    memcpy(buffer, hashes, count * sizeof(*hashes));
+    report->collisions = _HashQuality_count_collisions(buffer, count, ~0ULL, 0);
+
+    memcpy(buffer, hashes, count * sizeof(*hashes));
+    report->low_collisions = _HashQuality_count_collisions(buffer, count, 0xFFFFFFFFULL, 0);
+
+    memcpy(buffer, hashes, count * sizeof(*hashes));
+    report->high_collisions = _HashQuality_count_collisions(buffer, count, 0xFFFFFFFFULL, 32);
+
+    report->expected_collisions = (double) count * (double) (count - 1) / 2.0 / 4294967296.0;
+}
+
+static double _HashQuality_avalanche(hash_fn_t* hash_fn) {
+    size_t* flips = (size_t*) calloc(QUALITY_KEY_BITS * QUALITY_HASH_BITS, sizeof(*flips));
+    if (!flips) return 1.0;
+
+    uint64_t state = QUALITY_SEED;
+    char key[QUALITY_KEY_LENGTH] __attribute__((__aligned__(32))) = "";
+
+    for (size_t sample_id = 0; sample_id < QUALITY_AVALANCHE_SAMPLE_COUNT; ++sample_id) {
+        _HashQuality_fill(key, QUALITY_KEY_LENGTH, &state);
+        hash_t hash = _HashQuality_hash(hash_fn, key);
+
+        for (size_t in_bit = 0; in_bit < QUALITY_KEY_BITS; ++in_bit) {
+            _HashQuality_flip(key, in_bit);
+            hash_t difference = hash ^ _HashQuality_hash(hash_fn, key);
+            _HashQuality_flip(key, in_bit);
+
+            for (size_t out_bit = 0; out_bit < QUALITY_HASH_BITS; ++out_bit) {
+                flips[in_bit * QUALITY_HASH_BITS + out_bit] += (difference >> out_bit) & 1;
+            }
+        }
+    }
+
+    double worst_bias = 0.0;
+    for (size_t pair_id = 0; pair_id < QUALITY_KEY_BITS * QUALITY_HASH_BITS; ++pair_id) {
+        double bias = fabs(2.0 * (double) flips[pair_id] / (double) QUALITY_AVALANCHE_SAMPLE_COUNT - 1.0);
+        if (bias > worst_bias) worst_bias = bias;
+    }
+
+    free(flips);
+    return worst_bias;
+}
+
+//* Keys and their hashes are generated once, then flips of every input bit are gathered in turn.
+static double _HashQuality_bit_independence(hash_fn_t* hash_fn) {
+    char* keys = (char*) calloc(QUALITY_BIC_SAMPLE_COUNT, QUALITY_KEY_LENGTH);
+    hash_t* hashes = (hash_t*) calloc(QUALITY_BIC_SAMPLE_COUNT, sizeof(*hashes));
+    uint32_t* pair_flips = (uint32_t*) calloc(QUALITY_HASH_BITS * QUALITY_HASH_BITS, sizeof(*pair_flips));
+
+    double worst_bias = 1.0;
+
+    if (keys && hashes && pair_flips) {
+        uint64_t state = QUALITY_SEED;
+        _HashQuality_fill(keys, QUALITY_BIC_SAMPLE_COUNT * QUALITY_KEY_LENGTH, &state);
+        for (size_t sample_id = 0; sample_id < QUALITY_BIC_SAMPLE_COUNT; ++sample_id) {
+            hashes[sample_id] = _HashQuality_hash(hash_fn, keys + sample_id * QUALITY_KEY_LENGTH);
+        }
+
+        worst_bias = 0.0;
+
+        for (size_t in_bit = 0; in_bit < QUALITY_KEY_BITS; ++in_bit) {
+            memset(pair_flips, 0, QUALITY_HASH_BITS * QUALITY_HASH_BITS * sizeof(*pair_flips));
+
+            for (size_t sample_id = 0; sample_id < QUALITY_BIC_SAMPLE_COUNT; ++sample_id) {
+                char* key = keys + sample_id * QUALITY_KEY_LENGTH;
+
+                _HashQuality_flip(key, in_bit);
+                hash_t difference = hashes[sample_id] ^ _HashQuality_hash(hash_fn, key);
+                _HashQuality_flip(key, in_bit);
+
+                //* Only the flipped bits are visited, the diagonal keeps flip counts of the single bits.
+                for (hash_t first = difference; first; first &= first - 1) {
+                    size_t first_bit = (size_t) __builtin_ctzll(first);
+                    for (hash_t second = first; second; second &= second - 1) {
+                        ++pair_flips[first_bit * QUALITY_HASH_BITS + (size_t) __builtin_ctzll(second)];
+                    }
+                }
+            }
+
+            for (size_t first_bit = 0; first_bit < QUALITY_HASH_BITS; ++first_bit) {
+                double first_rate = pair_flips[first_bit * QUALITY_HASH_BITS + first_bit] / (double) QUALITY_BIC_SAMPLE_COUNT;
+
+                for (size_t second_bit = first_bit + 1; second_bit < QUALITY_HASH_BITS; ++second_bit) {
+                    double second_rate = pair_flips[second_bit * QUALITY_HASH_BITS + second_bit] / (double) QUALITY_BIC_SAMPLE_COUNT;
+                    double joint_rate = pair_flips[first_bit * QUALITY_HASH_BITS + second_bit] / (double) QUALITY_BIC_SAMPLE_COUNT;
+
+                    //* Bits that never (or always) flip are as bad as fully dependent ones.
+                    double variance = first_rate * (1.0 - first_rate) * second_rate * (1.0 - second_rate);
+                    double bias = variance <= 0.0 ? 1.0 : fabs(joint_rate - first_rate * second_rate) / sqrt(variance);
+
+                    if (bias > worst_bias) worst_bias = bias;
+                }
+            }
+        }
+    }
+
+    free(keys);
+    free(hashes);
+    free(pair_flips);
+    return worst_bias;
+}
+
+static size_t _HashQuality_sparse_key_count() {
+    size_t count = 1, combinations = 1;
+    for (size_t bit_count = 1; bit_count <= QUALITY_SPARSE_MAX_BITS; ++bit_count) {
+        combinations = combinations * (QUALITY_KEY_BITS - bit_count + 1) / bit_count;
+        count += combinations;
+    }
+    return count;
+}
+
+//* Hashes every key with the bits after min_bit set additionally to the ones already set in the key.
+static void _HashQuality_sparse(hash_fn_t* hash_fn, char* key, size_t min_bit, size_t bits_left, hash_t* hashes, size_t* count) {
+    hashes[(*count)++] = _HashQuality_hash(hash_fn, key);
+    if (bits_left == 0) return;
+
+    for (size_t bit_id = min_bit; bit_id < QUALITY_KEY_BITS; ++bit_id) {
+        _HashQuality_flip(key, bit_id);
+        _HashQuality_sparse(hash_fn, key, bit_id + 1, bits_left - 1, hashes, count);
+        _HashQuality_flip(key, bit_id);
+    }
+}
+
+void HashQuality_test(HashQualityReport* report, hash_fn_t* hash_fn, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(report && hash_fn, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    report->avalanche_bias = _HashQuality_avalanche(hash_fn);
+    report->bic_bias = _HashQuality_bit_independence(hash_fn);
+
+    size_t sparse_count = _HashQuality_sparse_key_count();
+    size_t max_count = sparse_count > QUALITY_COLLISION_KEY_COUNT ? sparse_count : QUALITY_COLLISION_KEY_COUNT;
+
+    hash_t* hashes = (hash_t*) calloc(max_count, sizeof(*hashes));
+    hash_t* buffer = (hash_t*) calloc(max_count, sizeof(*buffer));
+    _LOG_FAIL_CHECK_(hashes && buffer, "error", ERROR_REPORTS, { free(hashes); free(buffer); return; }, err_code, ENOMEM);
+
+    char key[QUALITY_KEY_LENGTH] __attribute__((__aligned__(32))) = "";
+    uint64_t state = QUALITY_SEED;
+
+    for (size_t key_id = 0; key_id < QUALITY_COLLISION_KEY_COUNT; ++key_id) {
+        _HashQuality_fill(key, QUALITY_KEY_LENGTH, &state);
+        hashes[key_id] = _HashQuality_hash(hash_fn, key);
+    }
+    _HashQuality_collisions(&report->random, hashes, buffer, QUALITY_COLLISION_KEY_COUNT);
+
+    memset(key, 0, sizeof(key));
+    size_t sparse_id = 0;
+    _HashQuality_sparse(hash_fn, key, 0, QUALITY_SPARSE_MAX_BITS, hashes, &sparse_id);
+    _HashQuality_collisions(&report->sparse, hashes, buffer, sparse_id);
+
+    //* Blocks are odd multiples of the key index, so all keys are distinct.
+    for (size_t key_id = 0; key_id < QUALITY_COLLISION_KEY_COUNT; ++key_id) {
+        uint32_t block = (uint32_t) key_id * 0x9E3779B1u;
+        for (size_t offset = 0; offset < QUALITY_KEY_LENGTH; offset += sizeof(block)) memcpy(key + offset, &block, sizeof(block));
+        hashes[key_id] = _HashQuality_hash(hash_fn, key);
+    }
+    _HashQuality_collisions(&report->cyclic, hashes, buffer, QUALITY_COLLISION_KEY_COUNT);
+
+    free(hashes);
+    free(buffer);
+}
+
+//* Time stamp counter ticks at a constant rate, so cycles are reference cycles rather than core ones.
+template <hash_fn_t* hash_fn>
+static double _HashQuality_time(const char* keys, size_t length, size_t stride) {
+    double best_time = HUGE_VAL;
+    hash_t sink = 0;
+
+    for (size_t trial_id = 0; trial_id < QUALITY_SPEED_TRIAL_COUNT; ++trial_id) {
+        _mm_lfence();
+        unsigned long long start = __rdtsc();
+
+        for (size_t key_id = 0; key_id < QUALITY_SPEED_KEY_COUNT; ++key_id) {
+            const char* key = keys + key_id * stride;
+            sink ^= hash_fn(key, key + length);
+        }
+
+        _mm_lfence();
+        double time = (double) (__rdtsc() - start) / (double) QUALITY_SPEED_KEY_COUNT;
+        if (time < best_time) best_time = time;
+    }
+
+    //* The hashes are used, so the calls can not be thrown away.
+    __asm__ volatile("" : : "r"(sink));
+
+    return best_time;
+}
+
+template <hash_fn_t* hash_fn>
+void HashQuality_measure_speed(HashQualityReport* report, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(report, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    char* keys = NULL;
+    int alloc_status = posix_memalign((void**) &keys, 32, QUALITY_SPEED_KEY_COUNT * QUALITY_BULK_LENGTH);
+    _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, return, err_code, ENOMEM);
+
+    uint64_t state = QUALITY_SEED;
+    _HashQuality_fill(keys, QUALITY_SPEED_KEY_COUNT * QUALITY_BULK_LENGTH, &state);
+
+    //* Small keys lie next to each other, as keys of the tables do.
+    for (size_t length_id = 0; length_id < QUALITY_SMALL_LENGTH_COUNT; ++length_id) {
+        size_t length = QUALITY_SMALL_LENGTHS[length_id];
+        report->cycles_per_hash[length_id] = _HashQuality_time<hash_fn>(keys, length, length);
+    }
+
+    report->cycles_per_byte = _HashQuality_time<hash_fn>(keys, QUALITY_BULK_LENGTH, QUALITY_BULK_LENGTH) /
+                              (double) QUALITY_BULK_LENGTH;
+
+    free(keys);
+}
+
+static void _HashQuality_print_collisions_header(FILE* file, const char* prefix) {
+    fprintf(file, ",%s_keys,%s_collisions,%s_low32,%s_high32,%s_expected32", prefix, prefix, prefix, prefix, prefix);
+}
+
+static void _HashQuality_print_collisions(FILE* file, const HashCollisionReport* report) {
+    fprintf(file, ",%lu,%lu,%lu,%lu,%.1lf", report->key_count, report->collisions,
+            report->low_collisions, report->high_collisions, report->expected_collisions);
+}
+
+void HashQuality_print_header(FILE* file) {
+    _LOG_FAIL_CHECK_(file, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    fprintf(file, "name,avalanche_bias,bic_bias");
+    _HashQuality_print_collisions_header(file, "random");
+    _HashQuality_print_collisions_header(file, "sparse");
+    _HashQuality_print_collisions_header(file, "cyclic");
+
+    for (size_t length_id = 0; length_id < QUALITY_SMALL_LENGTH_COUNT; ++length_id) {
+        fprintf(file, ",cycles_per_hash_%lu", QUALITY_SMALL_LENGTHS[length_id]);
+    }
+    fprintf(file, ",cycles_per_byte_%lu\n", QUALITY_BULK_LENGTH);
+}
+
+void HashQuality_print(FILE* file, const char* name, const HashQualityReport* report) {
+    _LOG_FAIL_CHECK_(file && name && report, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    fprintf(file, "%s,%.4lf,%.4lf", name, report->avalanche_bias, report->bic_bias);
+    _HashQuality_print_collisions(file, &report->random);
+    _HashQuality_print_collisions(file, &report->sparse);
+    _HashQuality_print_collisions(file, &report->cyclic);
+
+    for (size_t length_id = 0; length_id < QUALITY_SMALL_LENGTH_COUNT; ++length_id) {
+        fprintf(file, ",%.2lf", report->cycles_per_hash[length_id]);
+    }
+    fprintf(file, ",%.3lf\n", report->cycles_per_byte);
+}
+
+#endif
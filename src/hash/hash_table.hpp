@@ -16,25 +16,24 @@
 
 #include "src/utils/config.h"
 
-#if OPTIMIZATION_LEVEL < 1
-typedef const char* HT_ELEM_T;
-const HT_ELEM_T HT_ELEM_POISON = NULL;
-typedef HT_ELEM_T list_elem_t;
-#else
-typedef __m256i HT_ELEM_T __attribute__((__aligned__(32)));
-const HT_ELEM_T HT_ELEM_POISON = _mm256_set1_epi8(0);
-typedef HT_ELEM_T list_elem_t __attribute__((__aligned__(32)));
-#endif
+#include "table_elem.h"
+#include "hash_bucket.hpp"
+#include "fast_mod.h"
+#include "key_arena.hpp"
+#include "bloom_filter.hpp"
 
-static const list_elem_t LIST_ELEM_POISON = HT_ELEM_POISON;
+//* Number of old buckets moved to the new bucket array on every table access during rehash.
+static const size_t HT_MIGRATION_STEP = 4;
 
-#include "lib/list/listworks.h"
+static const size_t HT_GROWTH_FACTOR = 2;
 
-static const size_t DFLT_HT_CELL_SIZE = 256;
+//* The table shrinks when its load factor drops below HT_MAX_LOAD_FACTOR / HT_SHRINK_DIVISOR.
+static const size_t HT_SHRINK_DIVISOR = 8;
 
-typedef unsigned ht_status_t;
+//* Number of keys batched lookup prefetches at once.
+static const size_t HT_BATCH_GROUP = 16;
 
-typedef int ht_compar_fn_t(HT_ELEM_T alpha, HT_ELEM_T beta);
+typedef unsigned ht_status_t;
 
 enum HT_STATUS {
     HT_NULL         = 1 << 0,
@@ -42,9 +41,49 @@ enum HT_STATUS {
     HT_BROKEN_CELL  = 1 << 3,
 };
 
+/**
+ * @brief Hash table with chained buckets.
+ *
+ * The table grows when the load factor exceeds HT_MAX_LOAD_FACTOR and shrinks back
+ * (never below its initial bucket count) after mass erasure. Elements are then
+ * moved from the old bucket array to the new one HT_MIGRATION_STEP buckets at a time
+ * on subsequent table accesses.
+ *
+ * @param size number of stored elements
+ * @param min_bucket_count initial number of buckets
+ * @param bucket_count number of buckets
+ * @param bucket_mod precomputed reduction of hashes modulo bucket_count
+ * @param contents array of buckets
+ * @param hash_fn hash function the table is used with (NULL if the table should never be resized)
+ * @param seeded_hash_fn keyed hash function replacing hash_fn (NULL unless HashTable_seed() was called)
+ * @param seed key of seeded_hash_fn, a new one is drawn on every resize
+ * @param old_seed key the hashes of the elements in the array being migrated were calculated with
+ * @param old_bucket_count number of buckets in the array being migrated
+ * @param old_bucket_mod precomputed reduction of hashes modulo old_bucket_count
+ * @param old_contents array of buckets being migrated (NULL if no rehash is in progress)
+ * @param migrated index of the first old bucket that might not be migrated yet
+ * @param arena storage of the long keys (keys of erased elements are only released with the table)
+ * @param filter prefilter of the lookups (empty unless HashTable_reserve_filter() was called)
+ */
 struct HashTable {
     size_t size = 0;
-    List* contents = NULL;
+    size_t min_bucket_count = 0;
+    size_t bucket_count = 0;
+    FastMod bucket_mod = {};
+    HashBucket* contents = NULL;
+    hash_fn_t* hash_fn = NULL;
+
+    seeded_hash_fn_t* seeded_hash_fn = NULL;
+    HashSeed seed = {};
+    HashSeed old_seed = {};
+
+    size_t old_bucket_count = 0;
+    FastMod old_bucket_mod = {};
+    HashBucket* old_contents = NULL;
+    size_t migrated = 0;
+
+    KeyArena arena = {};
+    BloomFilter filter = {};
 };
 
 
@@ -54,9 +93,11 @@ struct HashTable {
  * @brief Construct hash table data structure
  * 
  * @param table pointer to the table
+ * @param bucket_count initial number of buckets
+ * @param hash_fn hash function the table is going to be used with (NULL to keep the bucket count fixed)
  * @param err_code pointer to the errno-functioning variable 
  */
-void HashTable_ctor(HashTable* table, ERROR_MARKER);
+void HashTable_ctor(HashTable* table, size_t bucket_count, hash_fn_t* hash_fn, ERROR_MARKER);
 
 /**
  * @brief Destroy the table
@@ -73,6 +114,27 @@ void HashTable_dtor(HashTable* table);
  */
 ht_status_t HashTable_status(const HashTable* table);
 
+/**
+ * @brief Make the table hash its elements with the seeded function under a random seed
+ *
+ * Hashes passed to the seeded table should then come from HashTable_hash(). Every resize draws
+ * a new seed, so hashes calculated before an insertion or erasure might be stale after it.
+ *
+ * @param table pointer to the empty table
+ * @param seeded_hash_fn seeded hash function
+ * @param err_code pointer to the errno-functioning variable
+ */
+void HashTable_seed(HashTable* table, seeded_hash_fn_t* seeded_hash_fn, ERROR_MARKER);
+
+/**
+ * @brief Calculate hash of the element the table expects
+ *
+ * @param table pointer to the table (should have a hash function)
+ * @param value element
+ * @return hash under the current seed for seeded tables, hash_fn hash otherwise
+ */
+hash_t HashTable_hash(const HashTable* table, HT_ELEM_T value);
+
 /**
  * @brief Insert an element 
  * 
@@ -84,13 +146,38 @@ ht_status_t HashTable_status(const HashTable* table);
 void HashTable_insert(HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t comparator, ERROR_MARKER);
 
 /**
- * @brief Get the list of elements matching specified hash from the table
+ * @brief Find an element or insert it if it is not in the table
+ * 
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return pointer to the value mapped to the element (zero-initialized for new elements, NULL on failure),
+ *         valid until the next access to the table
+ */
+ht_value_t* HashTable_upsert(HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Remove an element from the table
+ * 
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the element was present in the table
+ */
+bool HashTable_erase(HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Get the bucket of elements matching specified hash from the table
  * 
  * @param table pointer to the tables
  * @param hash hash to search for
- * @return pointer to the list where all elements match specified hash
+ * @return pointer to the bucket where all elements match specified hash
  */
-List* HashTable_find(const HashTable* table, hash_t hash);
+HashBucket* HashTable_find(HashTable* table, hash_t hash);
 
 /**
  * @brief Find element in hash table by its hash and value
@@ -99,101 +186,528 @@ List* HashTable_find(const HashTable* table, hash_t hash);
  * @param hash hash of the element
  * @param value exact value of the element
  * @param comparator comparator function between elements (should return 0 on equality)
- * @return pointer to the element cell in table (NULL if the element was not found)
+ * @return pointer to the element cell in table (NULL if the element was not found),
+ *         valid until the next access to the table
+ */
+HT_ELEM_T* HashTable_find_value(HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Find several elements in hash table, prefetching their buckets ahead of time
+ * 
+ * @param table hash table to search in
+ * @param hashes hashes of the elements
+ * @param values exact values of the elements
+ * @param count number of elements to search for
+ * @param results array the pointers to the found elements are written to (NULL for absent elements),
+ *                valid until the next access to the table
+ * @param comparator comparator function between elements (should return 0 on equality)
  */
-HT_ELEM_T* HashTable_find_value(const HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator);
+void HashTable_find_batch(HashTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                          HT_ELEM_T** results, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Get the number of buckets in the table
+ * 
+ * @param table
+ * @return size_t
+ */
+size_t HashTable_bucket_count(const HashTable* table);
+
+/**
+ * @brief Get the number of elements stored in the specified bucket
+ * 
+ * @param table
+ * @param bucket_id index of the bucket
+ * @return size_t
+ */
+size_t HashTable_bucket_size(const HashTable* table, size_t bucket_id);
+
+/**
+ * @brief Get the number of bytes the table occupies (not counting long keys and the filter)
+ *
+ * @param table
+ * @return size_t
+ */
+size_t HashTable_footprint(const HashTable* table);
+
+/**
+ * @brief Put Bloom filter in front of the lookups of the table
+ *
+ * Lookups of absent elements are then rejected after a single cache line access. Erased elements stay
+ * in the filter, and it loses precision once the table grows past the expected number of elements.
+ *
+ * @param table pointer to the table (should have a hash function if it is not empty)
+ * @param expected_count number of elements the filter is sized for
+ * @param err_code pointer to the errno-functioning variable
+ */
+void HashTable_reserve_filter(HashTable* table, size_t expected_count, ERROR_MARKER);
 
 
 //* IMPLEMENTATIONS ==============================
 
-void HashTable_ctor(HashTable* table, err_anchor_t err_code) {
-    _LOG_FAIL_CHECK_(table, "error", ERROR_REPORTS, return, err_code, EINVAL);
+static inline size_t _HashTable_bucket_id(const HashTable* table, hash_t hash) {
+    return (size_t) FastMod_reduce(&table->bucket_mod, hash);
+}
+
+static inline size_t _HashTable_old_bucket_id(const HashTable* table, hash_t hash) {
+    return (size_t) FastMod_reduce(&table->old_bucket_mod, hash);
+}
 
-    table->contents = (List*) calloc(BUCKET_COUNT, sizeof(*table->contents));
+hash_t HashTable_hash(const HashTable* table, HT_ELEM_T value) {
+    if (table->seeded_hash_fn) return hash_elem_seeded(table->seeded_hash_fn, &table->seed, &value);
+    return hash_elem(table->hash_fn, &value);
+}
+
+/**
+ * @brief Get hash the element has in the array being migrated (seeded tables hashed it under the previous seed).
+ */
+static inline hash_t _HashTable_old_hash(const HashTable* table, hash_t hash, HT_ELEM_T value) {
+    if (table->seeded_hash_fn) return hash_elem_seeded(table->seeded_hash_fn, &table->old_seed, &value);
+    return hash;
+}
+
+static inline bool _HashTable_resizable(const HashTable* table) {
+    return table->hash_fn || table->seeded_hash_fn;
+}
+
+static bool _is_prime(size_t number) {
+    if (number < 2) return false;
+    for (size_t divisor = 2; divisor * divisor <= number; ++divisor) {
+        if (number % divisor == 0) return false;
+    }
+    return true;
+}
+
+static inline ht_tag_t _HashTable_tag(hash_t hash) {
+    hash ^= hash >> 32;
+    hash ^= hash >> 16;
+    return (ht_tag_t) (hash ^ (hash >> 8));
+}
+
+/**
+ * @brief Allocate zeroed array of buckets.
+ *
+ * calloc() leaves untouched pages of big arrays unmapped, but does not guarantee the alignment
+ * of inline elements, so the array is aligned manually and the raw pointer is kept right before it.
+ */
+static HashBucket* _HashTable_alloc_buckets(size_t count) {
+    char* raw = (char*) calloc(count * sizeof(HashBucket) + alignof(HashBucket) + sizeof(void*), 1);
+    if (!raw) return NULL;
+
+    uintptr_t aligned = ((uintptr_t) (raw + sizeof(void*)) + alignof(HashBucket) - 1) & ~(alignof(HashBucket) - 1);
+    ((void**) aligned)[-1] = raw;
+
+    return (HashBucket*) aligned;
+}
+
+static void _HashTable_free_buckets(HashBucket* buckets) {
+    if (buckets) free(((void**) buckets)[-1]);
+}
+
+/**
+ * @brief Append element to its bucket in the current bucket array.
+ */
+static ht_value_t* _HashTable_push(HashTable* table, hash_t hash, HT_ELEM_T value, err_anchor_t err_code) {
+    HashBucket* bucket = &table->contents[_HashTable_bucket_id(table, hash)];
+    return HashBucket_push(bucket, value, _HashTable_tag(hash), err_code);
+}
 
-    if (!table->contents) {
-        *err_code = ENOMEM;
-        return;
+/**
+ * @brief Move all elements of the old bucket to the current bucket array.
+ */
+static void _HashTable_migrate_bucket(HashTable* table, size_t old_id, err_anchor_t err_code) {
+    HashBucket* bucket = &table->old_contents[old_id];
+    HT_ELEM_T* keys = HashBucket_keys(bucket);
+    void* values = HashBucket_values(bucket);
+
+    for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id) {
+        hash_t hash = HashTable_hash(table, keys[elem_id]);
+        ht_value_t* mapped = _HashTable_push(table, hash, keys[elem_id], err_code);
+        if (mapped) memcpy(mapped, value_at(values, elem_id), HT_VALUE_SIZE);
     }
 
-    table->size = 0;
+    HashBucket_dtor(bucket);
+}
 
-    for (size_t id = 0; id < BUCKET_COUNT; ++id) {
-        table->contents[id] = {};
-        List_ctor(&table->contents[id], DFLT_HT_CELL_SIZE, err_code);
-        if (List_status(&table->contents[id]) != 0) {
-            for (size_t rem_id = 0; rem_id < id; ++rem_id) List_dtor(table->contents + rem_id);
-            *table = {};
-            return;
+/**
+ * @brief Migrate up to step_count old buckets.
+ */
+static void _HashTable_migrate(HashTable* table, size_t step_count, err_anchor_t err_code) {
+    if (!table->old_contents) return;
+
+    for (size_t step = 0; step < step_count && table->migrated < table->old_bucket_count; ++step) {
+        _HashTable_migrate_bucket(table, table->migrated++, err_code);
+    }
+
+    if (table->migrated == table->old_bucket_count) {
+        _HashTable_free_buckets(table->old_contents);
+        table->old_contents = NULL;
+        table->old_bucket_count = 0;
+        table->migrated = 0;
+    }
+}
+
+/**
+ * @brief Adjust the number of buckets the table is about to be resized to.
+ */
+static size_t _HashTable_fit_bucket_count(const HashTable* table, size_t bucket_count) {
+    //* Tables that were given a non-power-of-two bucket count stay prime-sized.
+    if (table->bucket_mod.multiplier) {
+        while (!_is_prime(bucket_count)) ++bucket_count;
+    }
+
+    return bucket_count;
+}
+
+/**
+ * @brief Draw a new seed for the elements of the new bucket array.
+ *
+ * The filter holds hashes under the old seed, so it is refilled with the hashes of all elements under the new one.
+ */
+static void _HashTable_reseed(HashTable* table, err_anchor_t err_code) {
+    table->old_seed = table->seed;
+    hash_seed_draw(&table->seed, err_code);
+
+    if (!table->filter.blocks) return;
+
+    BloomFilter_clear(&table->filter);
+
+    for (size_t bucket_id = 0; bucket_id < table->old_bucket_count; ++bucket_id) {
+        HashBucket* bucket = &table->old_contents[bucket_id];
+        HT_ELEM_T* keys = HashBucket_keys(bucket);
+
+        for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id) {
+            BloomFilter_add(&table->filter, HashTable_hash(table, keys[elem_id]));
         }
     }
 }
 
+/**
+ * @brief Replace bucket array with a new one and start migration of elements.
+ */
+static void _HashTable_resize(HashTable* table, size_t new_bucket_count, err_anchor_t err_code) {
+    //* Zeroed buckets are valid empty buckets, so the resize itself does not touch them.
+    HashBucket* new_contents = _HashTable_alloc_buckets(new_bucket_count);
+    _LOG_FAIL_CHECK_(new_contents, "error", ERROR_REPORTS, return, err_code, ENOMEM);
+
+    table->old_contents = table->contents;
+    table->old_bucket_count = table->bucket_count;
+    table->old_bucket_mod = table->bucket_mod;
+    table->migrated = 0;
+
+    table->contents = new_contents;
+    table->bucket_count = new_bucket_count;
+    FastMod_ctor(&table->bucket_mod, new_bucket_count);
+
+    if (table->seeded_hash_fn) _HashTable_reseed(table, err_code);
+}
+
+void HashTable_ctor(HashTable* table, size_t bucket_count, hash_fn_t* hash_fn, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(table, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(bucket_count > 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *table = {};
+    table->hash_fn = hash_fn;
+
+    table->contents = _HashTable_alloc_buckets(bucket_count);
+    _LOG_FAIL_CHECK_(table->contents, "error", ERROR_REPORTS, return, err_code, ENOMEM);
+
+    //* Buckets allocate storage on their first overflow, so they are not constructed here.
+    table->bucket_count = bucket_count;
+    table->min_bucket_count = bucket_count;
+    FastMod_ctor(&table->bucket_mod, bucket_count);
+}
+
+void HashTable_seed(HashTable* table, seeded_hash_fn_t* seeded_hash_fn, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(seeded_hash_fn, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(table->size == 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    table->seeded_hash_fn = seeded_hash_fn;
+    hash_seed_draw(&table->seed, err_code);
+}
+
 void HashTable_dtor(HashTable* table) {
     _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
 
-    for (size_t id = 0; id < BUCKET_COUNT; id++) {
-        List_dtor(&table->contents[id], NULL);
+    for (size_t id = 0; id < table->bucket_count; id++) {
+        HashBucket_dtor(&table->contents[id]);
+    }
+
+    for (size_t id = 0; table->old_contents && id < table->old_bucket_count; id++) {
+        HashBucket_dtor(&table->old_contents[id]);
     }
 
-    free(table->contents);
+    _HashTable_free_buckets(table->contents);
+    _HashTable_free_buckets(table->old_contents);
+
+    KeyArena_dtor(&table->arena);
+    BloomFilter_dtor(&table->filter);
+
+    *table = {};
 }
 
 ht_status_t HashTable_status(const HashTable* table) {
     if (!table) return HT_NULL;
     if (!table->contents) return HT_NO_CONTENT;
 
-    #ifdef _DEBUG
     ht_status_t status = 0;
-    for (size_t id = 0; id < BUCKET_COUNT; ++id) {
-        if (List_status(&table->contents[id])) status |= HT_BROKEN_CELL;
+
+    #ifdef _DEBUG
+    for (size_t id = 0; id < table->bucket_count; ++id) {
+        if (HashBucket_status(&table->contents[id])) status |= HT_BROKEN_CELL;
     }
     #endif
 
-    return 0;
+    return status;
 }
 
 void HashTable_insert(HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t comparator, err_anchor_t err_code) {
-    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    HashTable_upsert(table, hash, value, comparator, err_code);
+}
+
+ht_value_t* HashTable_upsert(HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator,
+                             err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+
+    _HashTable_migrate(table, HT_MIGRATION_STEP, err_code);
+
+    ht_tag_t tag = _HashTable_tag(hash);
+
+    //* Elements rejected by the filter are new, so their buckets are not searched.
+    bool may_contain = !table->filter.blocks || BloomFilter_may_contain(&table->filter, hash);
 
-    if (HashTable_find_value(table, hash, value, comparator)) return;
+    HashBucket* bucket = &table->contents[_HashTable_bucket_id(table, hash)];
+    HT_ELEM_T* cell = may_contain ? HashBucket_find(bucket, value, tag, comparator) : NULL;
 
-    List* list = &table->contents[hash % BUCKET_COUNT];
+    if (!cell && may_contain && table->old_contents) {
+        hash_t old_hash = _HashTable_old_hash(table, hash, value);
+        bucket = &table->old_contents[_HashTable_old_bucket_id(table, old_hash)];
+        cell = HashBucket_find(bucket, value, _HashTable_tag(old_hash), comparator);
+    }
+
+    if (cell) return value_at(HashBucket_values(bucket), (size_t) (cell - HashBucket_keys(bucket)));
 
-    List_push(list, value, err_code);
+    if (!KeyArena_store_elem(&table->arena, &value, err_code)) return NULL;
+
+    if (_HashTable_resizable(table) && !table->old_contents && HT_MAX_LOAD_FACTOR &&
+        table->size >= table->bucket_count * HT_MAX_LOAD_FACTOR) {
+        _HashTable_resize(table, _HashTable_fit_bucket_count(table, table->bucket_count * HT_GROWTH_FACTOR), err_code);
+
+        //* The new bucket array of the seeded table is indexed with hashes under the new seed.
+        if (table->seeded_hash_fn) hash = HashTable_hash(table, value);
+    }
+
+    ht_value_t* mapped = _HashTable_push(table, hash, value, err_code);
+    if (!mapped) return NULL;
 
     ++table->size;
+    if (table->filter.blocks) BloomFilter_add(&table->filter, hash);
+
+    return mapped;
 }
 
-List* HashTable_find(const HashTable* table, hash_t hash) {
+bool HashTable_erase(HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    _HashTable_migrate(table, HT_MIGRATION_STEP, err_code);
+
+    ht_tag_t tag = _HashTable_tag(hash);
+
+    HashBucket* bucket = &table->contents[_HashTable_bucket_id(table, hash)];
+    HT_ELEM_T* cell = HashBucket_find(bucket, value, tag, comparator);
+
+    if (!cell && table->old_contents) {
+        hash_t old_hash = _HashTable_old_hash(table, hash, value);
+        bucket = &table->old_contents[_HashTable_old_bucket_id(table, old_hash)];
+        cell = HashBucket_find(bucket, value, _HashTable_tag(old_hash), comparator);
+    }
+
+    if (!cell) return false;
+
+    HashBucket_remove(bucket, (size_t) (cell - HashBucket_keys(bucket)));
+    HashBucket_shrink(bucket, err_code);
+
+    --table->size;
+
+    if (_HashTable_resizable(table) && !table->old_contents && HT_MAX_LOAD_FACTOR && table->bucket_count > table->min_bucket_count &&
+        table->size * HT_SHRINK_DIVISOR < table->bucket_count * HT_MAX_LOAD_FACTOR) {
+        size_t new_bucket_count = _HashTable_fit_bucket_count(table, table->bucket_count / HT_GROWTH_FACTOR);
+        if (new_bucket_count < table->min_bucket_count) new_bucket_count = table->min_bucket_count;
+
+        _HashTable_resize(table, new_bucket_count, err_code);
+    }
+
+    return true;
+}
+
+HashBucket* HashTable_find(HashTable* table, hash_t hash) {
     _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, NULL, EINVAL);
-    return &table->contents[hash % BUCKET_COUNT];
+
+    //* The result has to contain every element with this hash, so its old counterpart is moved first.
+    //* Old hashes of the seeded table are unknown without the elements, so its whole migration is finished.
+    if (table->old_contents && table->seeded_hash_fn) _HashTable_migrate(table, table->old_bucket_count, NULL);
+    if (table->old_contents) _HashTable_migrate_bucket(table, _HashTable_old_bucket_id(table, hash), NULL);
+
+    return &table->contents[_HashTable_bucket_id(table, hash)];
 }
 
-HT_ELEM_T* HashTable_find_value(const HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator) {
+/**
+ * @brief Find element in both bucket arrays without advancing the migration.
+ */
+static HT_ELEM_T* _HashTable_lookup(HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator) {
+    if (table->filter.blocks && !BloomFilter_may_contain(&table->filter, hash)) return NULL;
+
+    ht_tag_t tag = _HashTable_tag(hash);
+
+    if (table->old_contents) {
+        hash_t old_hash = _HashTable_old_hash(table, hash, value);
+        HashBucket* old_bucket = &table->old_contents[_HashTable_old_bucket_id(table, old_hash)];
+        HT_ELEM_T* old_cell = HashBucket_find(old_bucket, value, _HashTable_tag(old_hash), comparator);
+        if (old_cell) return old_cell;
+    }
+
+    return HashBucket_find(&table->contents[_HashTable_bucket_id(table, hash)], value, tag, comparator);
+}
+
+HT_ELEM_T* HashTable_find_value(HashTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator) {
     _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, NULL, EINVAL);
 
-    List* bucket = &table->contents[hash % BUCKET_COUNT];
-    _ListCell* iterator = &bucket->buffer[0];
+    _HashTable_migrate(table, HT_MIGRATION_STEP, NULL);
 
-    #if OPTIMIZATION_LEVEL == 0
-    for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id, ++iterator) {
-        if (iterator->content != HT_ELEM_POISON && comparator(iterator->content, value) == 0) return &iterator->content;
+    return _HashTable_lookup(table, hash, value, comparator);
+}
+
+static void _HashTable_prefetch_header(const HashBucket* bucket) {
+    for (size_t offset = 0; offset < sizeof(*bucket); offset += 64) {
+        _mm_prefetch((const char*) bucket + offset, _MM_HINT_T0);
     }
-    #endif
+}
+
+static void _HashTable_prefetch_tags(HashBucket* bucket) {
+    if (bucket->keys) _mm_prefetch((const char*) HashBucket_tags(bucket), _MM_HINT_T0);
+}
+
+/**
+ * @brief Request filter blocks of the group of elements from memory.
+ */
+static void _HashTable_prefetch_filter(const HashTable* table, const hash_t* hashes, size_t first, size_t count) {
+    for (size_t id = first; id < first + HT_BATCH_GROUP && id < count; ++id) {
+        BloomFilter_prefetch(&table->filter, hashes[id]);
+    }
+}
+
+/**
+ * @brief Check if the element passes the filter (if there is one).
+ */
+static inline bool _HashTable_may_contain(const HashTable* table, hash_t hash) {
+    return !table->filter.blocks || BloomFilter_may_contain(&table->filter, hash);
+}
+
+/**
+ * @brief Request bucket headers of the group of elements from memory (filter blocks should already be requested).
+ */
+static void _HashTable_prefetch_headers(const HashTable* table, const hash_t* hashes, size_t first, size_t count) {
+    for (size_t id = first; id < first + HT_BATCH_GROUP && id < count; ++id) {
+        if (!_HashTable_may_contain(table, hashes[id])) continue;
+
+        _HashTable_prefetch_header(&table->contents[_HashTable_bucket_id(table, hashes[id])]);
+        if (!table->old_contents || table->seeded_hash_fn) continue;
+        _HashTable_prefetch_header(&table->old_contents[_HashTable_old_bucket_id(table, hashes[id])]);
+    }
+}
+
+/**
+ * @brief Request heap tag arrays of the group of elements from memory (bucket headers should already be requested).
+ */
+static void _HashTable_prefetch_heaps(HashTable* table, const hash_t* hashes, size_t first, size_t count) {
+    for (size_t id = first; id < first + HT_BATCH_GROUP && id < count; ++id) {
+        if (!_HashTable_may_contain(table, hashes[id])) continue;
+
+        _HashTable_prefetch_tags(&table->contents[_HashTable_bucket_id(table, hashes[id])]);
+        if (!table->old_contents || table->seeded_hash_fn) continue;
+        _HashTable_prefetch_tags(&table->old_contents[_HashTable_old_bucket_id(table, hashes[id])]);
+    }
+}
+
+void HashTable_find_batch(HashTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                          HT_ELEM_T** results, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(count == 0 || (hashes && values && results), "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    _HashTable_migrate(table, HT_MIGRATION_STEP, NULL);
 
-    #if OPTIMIZATION_LEVEL >= 1
-    __m256i search_word = value;
+    //* Group prefetching: headers of one group, tags of the previous group and the elements of the group
+    //* before it are requested in the same pass, so lookups find their cache lines already loaded.
+    //* With the filter, its blocks are requested one group earlier and rejected elements are skipped afterwards.
+    size_t lead = table->filter.blocks ? HT_BATCH_GROUP : 0;
 
-    for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id, ++iterator) {
-        __m256i word = iterator->content;
-        if (_mm256_testc_si256(word, search_word)) {
-            return &iterator->content;
+    for (size_t group = 0; group < count + 2 * HT_BATCH_GROUP + lead; group += HT_BATCH_GROUP) {
+        if (lead) _HashTable_prefetch_filter(table, hashes, group, count);
+
+        if (group >= lead) _HashTable_prefetch_headers(table, hashes, group - lead, count);
+
+        if (group >= HT_BATCH_GROUP + lead) _HashTable_prefetch_heaps(table, hashes, group - lead - HT_BATCH_GROUP, count);
+
+        if (group < 2 * HT_BATCH_GROUP + lead) continue;
+
+        size_t first = group - lead - 2 * HT_BATCH_GROUP;
+        for (size_t id = first; id < first + HT_BATCH_GROUP && id < count; ++id) {
+            results[id] = _HashTable_lookup(table, hashes[id], values[id], comparator);
         }
     }
-    #endif
+}
+
+size_t HashTable_bucket_count(const HashTable* table) {
+    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    return table->bucket_count;
+}
 
-    return NULL;
+size_t HashTable_bucket_size(const HashTable* table, size_t bucket_id) {
+    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(bucket_id < table->bucket_count, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    return table->contents[bucket_id].size;
 }
 
-#endif
\ No newline at end of file
+size_t HashTable_footprint(const HashTable* table) {
+    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    size_t footprint = sizeof(*table) + table->bucket_count * sizeof(*table->contents);
+    for (size_t bucket_id = 0; bucket_id < table->bucket_count; ++bucket_id) {
+        footprint += HashBucket_heap_size(&table->contents[bucket_id]);
+    }
+
+    if (!table->old_contents) return footprint;
+
+    footprint += table->old_bucket_count * sizeof(*table->old_contents);
+    for (size_t bucket_id = table->migrated; bucket_id < table->old_bucket_count; ++bucket_id) {
+        footprint += HashBucket_heap_size(&table->old_contents[bucket_id]);
+    }
+
+    return footprint;
+}
+
+void HashTable_reserve_filter(HashTable* table, size_t expected_count, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(table->size == 0 || _HashTable_resizable(table), "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    BloomFilter_dtor(&table->filter);
+
+    if (expected_count < table->size) expected_count = table->size;
+
+    BloomFilter_ctor(&table->filter, expected_count, err_code);
+    if (!table->filter.blocks) return;
+
+    _HashTable_migrate(table, table->old_bucket_count, err_code);
+
+    for (size_t bucket_id = 0; bucket_id < table->bucket_count; ++bucket_id) {
+        HashBucket* bucket = &table->contents[bucket_id];
+        HT_ELEM_T* keys = HashBucket_keys(bucket);
+
+        for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id) {
+            BloomFilter_add(&table->filter, HashTable_hash(table, keys[elem_id]));
+        }
+    }
+}
+
+#endif
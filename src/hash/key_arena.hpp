@@ -0,0 +1,214 @@
+/**
+ * @file key_arena.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Append-only storage of long table keys.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef KEY_ARENA_HPP
+#define KEY_ARENA_HPP
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/utils/config.h"
+
+#include "table_elem.h"
+
+//* Size of a regular arena block (keys that do not fit it get a block of their own).
+static const size_t KEY_ARENA_BLOCK_SIZE = 1 << 16;
+
+//* Keys are zero-padded to a multiple of this size, so hash functions reading whole words stay inside the key copy.
+static const size_t KEY_ARENA_ALIGNMENT = 32;
+
+//* Every block starts with a pointer to the previous block, padded to keep the keys aligned.
+static const size_t KEY_ARENA_HEADER_SIZE = KEY_ARENA_ALIGNMENT;
+
+/**
+ * @brief Append-only storage of keys.
+ *
+ * Stored keys never move, so elements can point to them until the arena is destroyed.
+ * Zero-initialized arena is a valid empty arena.
+ *
+ * @param block the block keys are currently appended to (NULL if nothing was stored yet)
+ * @param used number of used bytes of the current block
+ * @param capacity size of the current block
+ */
+struct KeyArena {
+    char* block = NULL;
+    size_t used = 0;
+    size_t capacity = 0;
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Destroy the arena and all keys stored in it
+ *
+ * @param arena pointer to the arena
+ */
+void KeyArena_dtor(KeyArena* arena);
+
+/**
+ * @brief Copy the key to the arena
+ *
+ * @param arena pointer to the arena
+ * @param data key
+ * @param length length of the key
+ * @param err_code pointer to the errno-functioning variable
+ * @return null-terminated copy of the key (NULL on allocation failure)
+ */
+const char* KeyArena_store(KeyArena* arena, const char* data, size_t length, ERROR_MARKER);
+
+/**
+ * @brief Move the key of the element to the arena if the element does not store it inline
+ *
+ * @param arena pointer to the arena
+ * @param value element to update
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the element does not refer to the external memory anymore
+ */
+bool KeyArena_store_elem(KeyArena* arena, HT_ELEM_T* value, ERROR_MARKER);
+
+/**
+ * @brief Copy the key to the arena shared by several threads
+ *
+ * Every key gets a block of its own, published with a compare-and-swap, so it is only meant for rare long keys.
+ * KeyArena_store should not be called on the same arena at the same time.
+ *
+ * @param arena pointer to the arena
+ * @param data key
+ * @param length length of the key
+ * @param err_code pointer to the errno-functioning variable
+ * @return null-terminated copy of the key (NULL on allocation failure)
+ */
+const char* KeyArena_store_atomic(KeyArena* arena, const char* data, size_t length, ERROR_MARKER);
+
+/**
+ * @brief Thread-safe version of KeyArena_store_elem
+ *
+ * @param arena pointer to the arena
+ * @param value element to update
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the element does not refer to the external memory anymore
+ */
+bool KeyArena_store_elem_atomic(KeyArena* arena, HT_ELEM_T* value, ERROR_MARKER);
+
+
+//* IMPLEMENTATIONS ==============================
+
+/**
+ * @brief Get the length of the key the element refers to.
+ *
+ * @return 0 if the key does not need to be copied
+ */
+static inline size_t _KeyArena_external_length(const HT_ELEM_T* value) {
+    #if OPTIMIZATION_LEVEL < 1
+    //* Short keys are still referenced by the caller pointers to keep the unoptimized version as it was.
+    size_t length = strlen(*value);
+    return length <= HT_KEY_INLINE_LENGTH ? 0 : length;
+    #else
+    return elem_is_long(value) ? elem_length(value) : 0;
+    #endif
+}
+
+static inline size_t _KeyArena_padded_size(size_t length) {
+    return (length + KEY_ARENA_ALIGNMENT) / KEY_ARENA_ALIGNMENT * KEY_ARENA_ALIGNMENT;
+}
+
+void KeyArena_dtor(KeyArena* arena) {
+    _LOG_FAIL_CHECK_(arena, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    while (arena->block) {
+        char* previous = *(char**) arena->block;
+        free(arena->block);
+        arena->block = previous;
+    }
+
+    *arena = {};
+}
+
+const char* KeyArena_store(KeyArena* arena, const char* data, size_t length, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(arena, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(data, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+
+    size_t size = _KeyArena_padded_size(length);
+
+    if (arena->used + size > arena->capacity) {
+        size_t capacity = KEY_ARENA_HEADER_SIZE + size;
+        if (capacity < KEY_ARENA_BLOCK_SIZE) capacity = KEY_ARENA_BLOCK_SIZE;
+
+        char* block = NULL;
+        int alloc_status = posix_memalign((void**) &block, KEY_ARENA_ALIGNMENT, capacity);
+        _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, return NULL, err_code, ENOMEM);
+
+        *(char**) block = arena->block;
+
+        arena->block = block;
+        arena->used = KEY_ARENA_HEADER_SIZE;
+        arena->capacity = capacity;
+    }
+
+    char* copy = arena->block + arena->used;
+    memcpy(copy, data, length);
+    memset(copy + length, 0, size - length);
+
+    arena->used += size;
+
+    return copy;
+}
+
+bool KeyArena_store_elem(KeyArena* arena, HT_ELEM_T* value, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(value, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    size_t length = _KeyArena_external_length(value);
+    if (!length) return true;
+
+    const char* copy = KeyArena_store(arena, elem_data(value), length, err_code);
+    if (!copy) return false;
+
+    *value = elem_make(copy, length);
+    return true;
+}
+
+const char* KeyArena_store_atomic(KeyArena* arena, const char* data, size_t length, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(arena, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(data, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+
+    size_t size = _KeyArena_padded_size(length);
+
+    char* block = NULL;
+    int alloc_status = posix_memalign((void**) &block, KEY_ARENA_ALIGNMENT, KEY_ARENA_HEADER_SIZE + size);
+    _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, return NULL, err_code, ENOMEM);
+
+    char* copy = block + KEY_ARENA_HEADER_SIZE;
+    memcpy(copy, data, length);
+    memset(copy + length, 0, size - length);
+
+    char* previous = __atomic_load_n(&arena->block, __ATOMIC_RELAXED);
+    do {
+        *(char**) block = previous;
+    } while (!__atomic_compare_exchange_n(&arena->block, &previous, block, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    return copy;
+}
+
+bool KeyArena_store_elem_atomic(KeyArena* arena, HT_ELEM_T* value, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(value, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    size_t length = _KeyArena_external_length(value);
+    if (!length) return true;
+
+    const char* copy = KeyArena_store_atomic(arena, elem_data(value), length, err_code);
+    if (!copy) return false;
+
+    *value = elem_make(copy, length);
+    return true;
+}
+
+#endif
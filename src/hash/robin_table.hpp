@@ -0,0 +1,477 @@
+/**
+ * @file robin_table.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Open-addressing hash table with Robin Hood displacement.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef ROBIN_TABLE_HPP
+#define ROBIN_TABLE_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "src/utils/config.h"
+
+#include "table_elem.h"
+#include "key_arena.hpp"
+
+//* The table grows when its load factor exceeds ROBIN_MAX_LOAD_NUM / ROBIN_MAX_LOAD_DEN.
+static const size_t ROBIN_MAX_LOAD_NUM = 7;
+static const size_t ROBIN_MAX_LOAD_DEN = 8;
+
+//* The table shrinks when its load factor drops below 1 / ROBIN_SHRINK_DIVISOR.
+static const size_t ROBIN_SHRINK_DIVISOR = 8;
+
+//* Number of keys batched lookup prefetches at once.
+static const size_t ROBIN_BATCH_GROUP = 16;
+
+//* Minimal number of slots of the table.
+static const size_t ROBIN_MIN_CAPACITY = 16;
+
+typedef unsigned robin_status_t;
+
+enum ROBIN_STATUS {
+    ROBIN_NULL          = 1 << 0,
+    ROBIN_NO_CONTENT    = 1 << 1,
+    ROBIN_BAD_CAPACITY  = 1 << 2,
+    ROBIN_BIG_SIZE      = 1 << 3,
+};
+
+/**
+ * @brief Probe state of the slot.
+ *
+ * @param distance distance from the home slot of the element plus one (0 for empty slots)
+ * @param hash lower half of the element hash (enough to find home slots of tables up to 2^32 slots)
+ */
+struct RobinMeta {
+    uint32_t distance;
+    uint32_t hash;
+};
+
+/**
+ * @brief Open-addressing hash table with linear probing and Robin Hood displacement.
+ *
+ * Elements farther from their home slots take the slots of the closer ones, so elements
+ * with the same home slot form a contiguous run and lookup of a missing element stops
+ * as soon as it reaches an element closer to its home than the element being searched for.
+ * Erasure shifts the rest of the run back instead of leaving tombstones.
+ *
+ * @param size number of stored elements
+ * @param min_capacity initial number of slots (the table never shrinks below it)
+ * @param capacity number of slots (power of two)
+ * @param meta probe state of each slot
+ * @param slots element storage followed by the values of the elements
+ * @param hash_fn hash function the table is used with
+ * @param arena storage of the long keys (keys of erased elements are only released with the table)
+ */
+struct RobinTable {
+    size_t size = 0;
+    size_t min_capacity = 0;
+    size_t capacity = 0;
+    RobinMeta* meta = NULL;
+    HT_ELEM_T* slots = NULL;
+    hash_fn_t* hash_fn = NULL;
+    KeyArena arena = {};
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Construct Robin Hood table data structure
+ *
+ * @param table pointer to the table
+ * @param bucket_count initial number of slots (rounded up to a power of two)
+ * @param hash_fn hash function the table is going to be used with
+ * @param err_code pointer to the errno-functioning variable
+ */
+void RobinTable_ctor(RobinTable* table, size_t bucket_count, hash_fn_t* hash_fn, ERROR_MARKER);
+
+/**
+ * @brief Destroy the table
+ *
+ * @param table pointer to the table to destroy
+ */
+void RobinTable_dtor(RobinTable* table);
+
+/**
+ * @brief Get status of the table
+ *
+ * @param table pointer to the table
+ * @return robin_status_t
+ */
+robin_status_t RobinTable_status(const RobinTable* table);
+
+/**
+ * @brief Insert an element
+ *
+ * @param table pointer to the table
+ * @param hash hash of the new element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void RobinTable_insert(RobinTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t comparator, ERROR_MARKER);
+
+/**
+ * @brief Find an element or insert it if it is not in the table
+ *
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return pointer to the value mapped to the element (zero-initialized for new elements, NULL on failure),
+ *         valid until the next insertion or erasure
+ */
+ht_value_t* RobinTable_upsert(RobinTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Remove an element from the table
+ *
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the element was present in the table
+ */
+bool RobinTable_erase(RobinTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Find element in the table by its hash and value
+ *
+ * @param table table to search in
+ * @param hash hash of the element
+ * @param value exact value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @return pointer to the element slot in the table (NULL if the element was not found)
+ */
+HT_ELEM_T* RobinTable_find_value(const RobinTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Find several elements in the table, prefetching their home slots ahead of time
+ *
+ * @param table table to search in
+ * @param hashes hashes of the elements
+ * @param values exact values of the elements
+ * @param count number of elements to search for
+ * @param results array the pointers to the found slots are written to (NULL for absent elements)
+ * @param comparator comparator function between elements (should return 0 on equality)
+ */
+void RobinTable_find_batch(const RobinTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                           HT_ELEM_T** results, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Get the number of home slots in the table
+ *
+ * @param table
+ * @return size_t
+ */
+size_t RobinTable_bucket_count(const RobinTable* table);
+
+/**
+ * @brief Get the number of elements whose home is the specified slot
+ *
+ * @param table
+ * @param bucket_id index of the home slot
+ * @return size_t
+ */
+size_t RobinTable_bucket_size(const RobinTable* table, size_t bucket_id);
+
+/**
+ * @brief Get the distance between the slot and the home slot of its element
+ *
+ * @param table
+ * @param slot_id index of the slot
+ * @return number of slots lookup of the element probes (0 for empty slots)
+ */
+size_t RobinTable_probe_length(const RobinTable* table, size_t slot_id);
+
+
+//* IMPLEMENTATIONS ==============================
+
+static inline size_t _RobinTable_home(const RobinTable* table, uint32_t hash) {
+    return (size_t) hash & (table->capacity - 1);
+}
+
+static inline void* _RobinTable_values(const RobinTable* table) {
+    return table->slots + table->capacity;
+}
+
+static void _RobinTable_allocate(RobinTable* table, size_t capacity, err_anchor_t err_code) {
+    table->meta = (RobinMeta*) calloc(capacity, sizeof(*table->meta));
+    table->slots = NULL;
+
+    int slot_status = posix_memalign((void**) &table->slots, 32, capacity * (sizeof(*table->slots) + HT_VALUE_SIZE));
+
+    if (!table->meta || slot_status != 0) {
+        free(table->meta);
+        if (slot_status == 0) free(table->slots);
+        table->meta = NULL;
+        table->slots = NULL;
+        if (err_code) *err_code = ENOMEM;
+        return;
+    }
+
+    table->capacity = capacity;
+    table->size = 0;
+}
+
+/**
+ * @brief Put the element into the table, displacing elements closer to their home slots.
+ *
+ * @param table table with at least one empty slot
+ * @param hash lower half of the element hash
+ * @param value element
+ * @param mapped value of the element
+ * @return index of the slot the element was put into (elements displaced afterwards do not move it)
+ */
+static size_t _RobinTable_place(RobinTable* table, uint32_t hash, HT_ELEM_T value, const void* mapped) {
+    void* values = _RobinTable_values(table);
+    size_t mask = table->capacity - 1;
+
+    RobinMeta carried = {1, hash};
+    ht_value_t carried_value = {};
+    memcpy(&carried_value, mapped, HT_VALUE_SIZE);
+
+    size_t placed = SIZE_MAX;
+
+    for (size_t slot_id = _RobinTable_home(table, hash); ; slot_id = (slot_id + 1) & mask, ++carried.distance) {
+        RobinMeta* meta = &table->meta[slot_id];
+
+        if (meta->distance == 0) {
+            *meta = carried;
+            table->slots[slot_id] = value;
+            memcpy(value_at(values, slot_id), &carried_value, HT_VALUE_SIZE);
+
+            return placed == SIZE_MAX ? slot_id : placed;
+        }
+
+        if (meta->distance >= carried.distance) continue;
+
+        RobinMeta displaced = *meta;
+        *meta = carried;
+        carried = displaced;
+
+        HT_ELEM_T displaced_value = table->slots[slot_id];
+        table->slots[slot_id] = value;
+        value = displaced_value;
+
+        ht_value_t displaced_mapped = {};
+        memcpy(&displaced_mapped, value_at(values, slot_id), HT_VALUE_SIZE);
+        memcpy(value_at(values, slot_id), &carried_value, HT_VALUE_SIZE);
+        carried_value = displaced_mapped;
+
+        if (placed == SIZE_MAX) placed = slot_id;
+    }
+}
+
+static void _RobinTable_rehash(RobinTable* table, size_t new_capacity, err_anchor_t err_code) {
+    RobinTable old_table = *table;
+
+    _RobinTable_allocate(table, new_capacity, err_code);
+    if (!table->meta) {
+        *table = old_table;
+        return;
+    }
+
+    void* old_values = _RobinTable_values(&old_table);
+
+    //* Stored hashes are enough to find new home slots, keys are not hashed again.
+    for (size_t slot_id = 0; slot_id < old_table.capacity; ++slot_id) {
+        if (old_table.meta[slot_id].distance == 0) continue;
+
+        _RobinTable_place(table, old_table.meta[slot_id].hash, old_table.slots[slot_id], value_at(old_values, slot_id));
+    }
+
+    table->size = old_table.size;
+
+    free(old_table.meta);
+    free(old_table.slots);
+}
+
+void RobinTable_ctor(RobinTable* table, size_t bucket_count, hash_fn_t* hash_fn, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(table, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(hash_fn, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *table = {};
+    table->hash_fn = hash_fn;
+
+    size_t capacity = ROBIN_MIN_CAPACITY;
+    while (capacity < bucket_count) capacity *= 2;
+
+    _RobinTable_allocate(table, capacity, err_code);
+    table->min_capacity = table->capacity;
+}
+
+void RobinTable_dtor(RobinTable* table) {
+    _LOG_FAIL_CHECK_(RobinTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    free(table->meta);
+    free(table->slots);
+
+    KeyArena_dtor(&table->arena);
+
+    *table = {};
+}
+
+robin_status_t RobinTable_status(const RobinTable* table) {
+    if (!table) return ROBIN_NULL;
+    if (!table->meta || !table->slots) return ROBIN_NO_CONTENT;
+
+    robin_status_t status = 0;
+
+    if (table->capacity < ROBIN_MIN_CAPACITY || (table->capacity & (table->capacity - 1)) || table->capacity > UINT32_MAX)
+        status |= ROBIN_BAD_CAPACITY;
+    if (table->size >= table->capacity) status |= ROBIN_BIG_SIZE;
+
+    return status;
+}
+
+void RobinTable_insert(RobinTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t comparator, err_anchor_t err_code) {
+    RobinTable_upsert(table, hash, value, comparator, err_code);
+}
+
+ht_value_t* RobinTable_upsert(RobinTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator,
+                              err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(RobinTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+
+    HT_ELEM_T* found = RobinTable_find_value(table, hash, value, comparator);
+    if (found) return value_at(_RobinTable_values(table), (size_t) (found - table->slots));
+
+    if (!KeyArena_store_elem(&table->arena, &value, err_code)) return NULL;
+
+    if ((table->size + 1) * ROBIN_MAX_LOAD_DEN > table->capacity * ROBIN_MAX_LOAD_NUM) {
+        _RobinTable_rehash(table, table->capacity * 2, err_code);
+
+        //* The table is only ever completely filled if it could not grow.
+        _LOG_FAIL_CHECK_(table->size + 1 < table->capacity, "error", ERROR_REPORTS, return NULL, err_code, ENOMEM);
+    }
+
+    const ht_value_t zero = {};
+    size_t slot_id = _RobinTable_place(table, (uint32_t) hash, value, &zero);
+
+    ++table->size;
+
+    return value_at(_RobinTable_values(table), slot_id);
+}
+
+bool RobinTable_erase(RobinTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(RobinTable_status(table) == 0, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    HT_ELEM_T* slot = RobinTable_find_value(table, hash, value, comparator);
+    if (!slot) return false;
+
+    void* values = _RobinTable_values(table);
+    size_t mask = table->capacity - 1;
+    size_t slot_id = (size_t) (slot - table->slots);
+
+    //* The rest of the run moves one slot closer to home until an empty slot or an element already at home.
+    for (size_t next_id = (slot_id + 1) & mask; table->meta[next_id].distance > 1; next_id = (next_id + 1) & mask) {
+        table->meta[slot_id] = {table->meta[next_id].distance - 1, table->meta[next_id].hash};
+        table->slots[slot_id] = table->slots[next_id];
+        memcpy(value_at(values, slot_id), value_at(values, next_id), HT_VALUE_SIZE);
+
+        slot_id = next_id;
+    }
+
+    table->meta[slot_id] = {};
+    --table->size;
+
+    if (table->capacity > table->min_capacity && table->size * ROBIN_SHRINK_DIVISOR < table->capacity) {
+        _RobinTable_rehash(table, table->capacity / 2, err_code);
+    }
+
+    return true;
+}
+
+HT_ELEM_T* RobinTable_find_value(const RobinTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(RobinTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, NULL, EINVAL);
+
+    size_t mask = table->capacity - 1;
+    uint32_t low_hash = (uint32_t) hash;
+    size_t slot_id = _RobinTable_home(table, low_hash);
+
+    //* Empty slots have zero distance, so they stop the search as well.
+    for (uint32_t distance = 1; table->meta[slot_id].distance >= distance; ++distance, slot_id = (slot_id + 1) & mask) {
+        if (table->meta[slot_id].hash == low_hash && elem_equal(table->slots[slot_id], value, comparator)) {
+            return &table->slots[slot_id];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Request probe states of the home slots of the group of elements from memory.
+ */
+static void _RobinTable_prefetch_meta(const RobinTable* table, const hash_t* hashes, size_t first, size_t count) {
+    for (size_t id = first; id < first + ROBIN_BATCH_GROUP && id < count; ++id) {
+        _mm_prefetch((const char*) (table->meta + _RobinTable_home(table, (uint32_t) hashes[id])), _MM_HINT_T0);
+    }
+}
+
+/**
+ * @brief Request the home slots of the group of elements from memory.
+ */
+static void _RobinTable_prefetch_slots(const RobinTable* table, const hash_t* hashes, size_t first, size_t count) {
+    for (size_t id = first; id < first + ROBIN_BATCH_GROUP && id < count; ++id) {
+        _mm_prefetch((const char*) (table->slots + _RobinTable_home(table, (uint32_t) hashes[id])), _MM_HINT_T0);
+    }
+}
+
+void RobinTable_find_batch(const RobinTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                           HT_ELEM_T** results, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(RobinTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(count == 0 || (hashes && values && results), "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    //* Same three-stage pipeline as the swiss table: probe states, then home slots, then the lookups themselves.
+    for (size_t group = 0; group < count + 2 * ROBIN_BATCH_GROUP; group += ROBIN_BATCH_GROUP) {
+        _RobinTable_prefetch_meta(table, hashes, group, count);
+
+        if (group >= ROBIN_BATCH_GROUP) _RobinTable_prefetch_slots(table, hashes, group - ROBIN_BATCH_GROUP, count);
+
+        if (group < 2 * ROBIN_BATCH_GROUP) continue;
+
+        size_t first = group - 2 * ROBIN_BATCH_GROUP;
+        for (size_t id = first; id < first + ROBIN_BATCH_GROUP && id < count; ++id) {
+            results[id] = RobinTable_find_value(table, hashes[id], values[id], comparator);
+        }
+    }
+}
+
+size_t RobinTable_bucket_count(const RobinTable* table) {
+    _LOG_FAIL_CHECK_(RobinTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    return table->capacity;
+}
+
+size_t RobinTable_bucket_size(const RobinTable* table, size_t bucket_id) {
+    _LOG_FAIL_CHECK_(RobinTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(bucket_id < table->capacity, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    size_t mask = table->capacity - 1;
+    size_t size = 0;
+
+    //* Elements of the home slot are somewhere in the run that passes through it.
+    for (size_t slot_id = bucket_id, distance = 1; table->meta[slot_id].distance >= distance; slot_id = (slot_id + 1) & mask, ++distance) {
+        if (table->meta[slot_id].distance == distance) ++size;
+    }
+
+    return size;
+}
+
+size_t RobinTable_probe_length(const RobinTable* table, size_t slot_id) {
+    _LOG_FAIL_CHECK_(RobinTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(slot_id < table->capacity, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    return table->meta[slot_id].distance;
+}
+
+#endif
@@ -0,0 +1,615 @@
+/**
+ * @file sharded_table.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Hash table split into independent shards for parallel construction.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef SHARDED_TABLE_HPP
+#define SHARDED_TABLE_HPP
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/utils/config.h"
+
+#include "table_elem.h"
+#include "hash_table.hpp"
+#include "key_arena.hpp"
+
+//* Shards are selected by SHARD_BITS highest bits of the hash (buckets and tags of the shards use the lower ones).
+static const unsigned SHARD_BITS = 6;
+static const size_t SHARD_COUNT = (size_t) 1 << SHARD_BITS;
+
+//* Max number of threads building or merging the table.
+static const unsigned SHARD_MAX_THREAD_COUNT = 64;
+
+//* Shards of different threads are written at once while building, so every shard takes cache lines of its own.
+static const size_t SHARD_ALIGNMENT = 64;
+
+typedef unsigned shard_status_t;
+
+enum SHARD_STATUS {
+    SHARD_NULL          = 1 << 0,
+    SHARD_NO_CONTENT    = 1 << 1,
+    SHARD_BROKEN_SHARD  = 1 << 2,
+};
+
+/**
+ * @brief Shard of the sharded table padded to whole cache lines.
+ *
+ * @param table elements of the shard
+ */
+struct alignas(SHARD_ALIGNMENT) ShardSlot {
+    HashTable table = {};
+};
+
+/**
+ * @brief Hash table made of independent HashTable shards.
+ *
+ * Every shard only holds the keys selected by the highest bits of their hashes, so the shards
+ * can be filled by different threads without any synchronization (see ShardedTable_build).
+ * Lookups go to the single shard the key belongs to, so the table answers exactly like a single
+ * HashTable with the same contents. ShardedTable_merge turns it into such a table.
+ *
+ * @param size number of stored elements
+ * @param shards array of SHARD_COUNT tables holding the elements
+ */
+struct ShardedTable {
+    size_t size = 0;
+    ShardSlot* shards = NULL;
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Construct sharded table data structure
+ *
+ * @param table pointer to the table
+ * @param bucket_count initial number of buckets of the whole table (split evenly between the shards)
+ * @param hash_fn hash function the table is going to be used with (NULL if the shards should never be resized)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void ShardedTable_ctor(ShardedTable* table, size_t bucket_count, hash_fn_t* hash_fn, ERROR_MARKER);
+
+/**
+ * @brief Destroy the table
+ *
+ * @param table pointer to the table to destroy
+ */
+void ShardedTable_dtor(ShardedTable* table);
+
+/**
+ * @brief Get status of the table
+ *
+ * @param table pointer to the table
+ * @return shard_status_t
+ */
+shard_status_t ShardedTable_status(const ShardedTable* table);
+
+/**
+ * @brief Insert several elements using several threads
+ *
+ * Elements are partitioned by their shards first, then every thread inserts the elements of its own shards
+ * in the order they are listed in, so the result is the same as after inserting them one by one.
+ *
+ * @param table pointer to the table
+ * @param hashes hashes of the new elements
+ * @param values values of the new elements
+ * @param count number of elements to insert
+ * @param thread_count number of threads to use (at most SHARD_MAX_THREAD_COUNT)
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void ShardedTable_build(ShardedTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                        unsigned thread_count, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Move all elements of the table to a single HashTable using several threads
+ *
+ * Every thread fills its own range of result buckets, so no two threads write to the same bucket.
+ * Long keys are copied to the result, so it stays valid after the sharded table is destroyed.
+ *
+ * @param table pointer to the table (its shards are migrated, but keep their elements)
+ * @param result pointer to the table to construct
+ * @param bucket_count initial number of buckets of the result (raised if the elements do not fit it)
+ * @param hash_fn hash function the result is going to be used with (the elements are rehashed with it)
+ * @param thread_count number of threads to use (at most SHARD_MAX_THREAD_COUNT)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void ShardedTable_merge(ShardedTable* table, HashTable* result, size_t bucket_count, hash_fn_t* hash_fn,
+                        unsigned thread_count, ERROR_MARKER);
+
+/**
+ * @brief Insert an element
+ *
+ * @param table pointer to the table
+ * @param hash hash of the new element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void ShardedTable_insert(ShardedTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Insert an element unless it is already present and get its value
+ *
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return pointer to the value of the element (NULL on allocation failure), valid until the next access to the table
+ */
+ht_value_t* ShardedTable_upsert(ShardedTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Remove an element from the table
+ *
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the element was present in the table
+ */
+bool ShardedTable_erase(ShardedTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Find element in the table by its hash and value
+ *
+ * @param table table to search in
+ * @param hash hash of the element
+ * @param value exact value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @return pointer to the element cell in the table (NULL if the element was not found),
+ *         valid until the next access to the table
+ */
+HT_ELEM_T* ShardedTable_find_value(ShardedTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Find several elements in the table, prefetching their buckets ahead of time
+ *
+ * @param table table to search in
+ * @param hashes hashes of the elements
+ * @param values exact values of the elements
+ * @param count number of elements to search for
+ * @param results array the pointers to the found elements are written to (NULL for absent elements),
+ *                valid until the next access to the table
+ * @param comparator comparator function between elements (should return 0 on equality)
+ */
+void ShardedTable_find_batch(ShardedTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                             HT_ELEM_T** results, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Get the number of buckets in all shards
+ *
+ * @param table
+ * @return size_t
+ */
+size_t ShardedTable_bucket_count(const ShardedTable* table);
+
+/**
+ * @brief Get the number of elements stored in the specified bucket (buckets of the shards are numbered one after another)
+ *
+ * @param table
+ * @param bucket_id index of the bucket
+ * @return size_t
+ */
+size_t ShardedTable_bucket_size(const ShardedTable* table, size_t bucket_id);
+
+
+//* IMPLEMENTATIONS ==============================
+
+static inline size_t _ShardedTable_shard_id(hash_t hash) { return (size_t) (hash >> (64 - SHARD_BITS)); }
+
+/**
+ * @brief Part of the work of a single thread building or merging the table.
+ *
+ * @param table table being built or merged
+ * @param thread_id index of the thread
+ * @param thread_count number of threads
+ * @param counts number of elements every thread has for every target (shard or range of result buckets)
+ * @param error errno-functioning variable of the thread (merged into the caller's one after the threads are joined)
+ */
+struct _ShardTask {
+    ShardedTable* table;
+    unsigned thread_id;
+    unsigned thread_count;
+    size_t* counts;
+    int error;
+
+    const hash_t* hashes;       //* build: hashes of the new elements
+    const HT_ELEM_T* values;    //* build: new elements
+    size_t count;               //* build: number of new elements
+    size_t* order;              //* build: indices of the new elements grouped by shard
+    ht_compar_fn_t* comparator; //* build: comparator function between elements
+
+    HashTable* result;          //* merge: table the elements are moved to
+    hash_t* staged_hashes;      //* merge: hashes of the elements grouped by bucket range of the result
+    HT_ELEM_T* staged_keys;     //* merge: elements grouped by bucket range of the result
+    const void** staged_values; //* merge: values of the elements grouped by bucket range of the result
+};
+
+/**
+ * @brief Run the routine in thread_count threads and wait for all of them.
+ */
+static void _ShardedTable_run(void* (*routine)(void*), _ShardTask* tasks, unsigned thread_count) {
+    pthread_t threads[SHARD_MAX_THREAD_COUNT] = {};
+
+    for (unsigned thread_id = 1; thread_id < thread_count; ++thread_id) {
+        pthread_create(&threads[thread_id], NULL, routine, &tasks[thread_id]);
+    }
+
+    routine(&tasks[0]);
+
+    for (unsigned thread_id = 1; thread_id < thread_count; ++thread_id) pthread_join(threads[thread_id], NULL);
+}
+
+/**
+ * @brief Report the first error the threads have run into.
+ */
+static void _ShardedTable_merge_errors(const _ShardTask* tasks, unsigned thread_count, err_anchor_t err_code) {
+    for (unsigned thread_id = 0; thread_id < thread_count; ++thread_id) {
+        if (tasks[thread_id].error && err_code) {
+            *err_code = tasks[thread_id].error;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Turn element counts into offsets of the elements of every thread in the target-major order.
+ *
+ * @param counts counts[thread_id * target_count + target_id], replaced with the offsets
+ * @param bounds bounds[target_id] is set to the offset of the first element of the target (bounds[target_count] to the total)
+ */
+static void _ShardedTable_offsets(size_t* counts, size_t* bounds, unsigned thread_count, size_t target_count) {
+    size_t offset = 0;
+
+    for (size_t target_id = 0; target_id < target_count; ++target_id) {
+        bounds[target_id] = offset;
+
+        for (unsigned thread_id = 0; thread_id < thread_count; ++thread_id) {
+            size_t count = counts[thread_id * target_count + target_id];
+            counts[thread_id * target_count + target_id] = offset;
+            offset += count;
+        }
+    }
+
+    bounds[target_count] = offset;
+}
+
+static inline size_t _ShardTask_first(const _ShardTask* task) { return task->count * task->thread_id / task->thread_count; }
+static inline size_t _ShardTask_last(const _ShardTask* task) { return task->count * (task->thread_id + 1) / task->thread_count; }
+
+static void* _ShardedTable_count_routine(void* arg) {
+    _ShardTask* task = (_ShardTask*) arg;
+    size_t* counts = task->counts + task->thread_id * SHARD_COUNT;
+
+    for (size_t id = _ShardTask_first(task); id < _ShardTask_last(task); ++id) ++counts[_ShardedTable_shard_id(task->hashes[id])];
+
+    return NULL;
+}
+
+static void* _ShardedTable_scatter_routine(void* arg) {
+    _ShardTask* task = (_ShardTask*) arg;
+    size_t* offsets = task->counts + task->thread_id * SHARD_COUNT;
+
+    for (size_t id = _ShardTask_first(task); id < _ShardTask_last(task); ++id) {
+        task->order[offsets[_ShardedTable_shard_id(task->hashes[id])]++] = id;
+    }
+
+    return NULL;
+}
+
+static void* _ShardedTable_insert_routine(void* arg) {
+    _ShardTask* task = (_ShardTask*) arg;
+    const size_t* bounds = task->counts + task->thread_count * SHARD_COUNT;
+
+    for (size_t shard_id = task->thread_id; shard_id < SHARD_COUNT; shard_id += task->thread_count) {
+        for (size_t index = bounds[shard_id]; index < bounds[shard_id + 1]; ++index) {
+            size_t id = task->order[index];
+            HashTable_insert(&task->table->shards[shard_id].table, task->hashes[id], task->values[id], task->comparator,
+                             &task->error);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Count the elements of the shards of the thread by bucket ranges of the result or stage them.
+ *
+ * @param task task of the thread
+ * @param stage false to count the elements, true to stage them at the offsets the counts were replaced with
+ */
+static void _ShardedTable_stage_elements(_ShardTask* task, bool stage) {
+    size_t* counts = task->counts + task->thread_id * task->thread_count;
+
+    for (size_t shard_id = task->thread_id; shard_id < SHARD_COUNT; shard_id += task->thread_count) {
+        HashTable* shard = &task->table->shards[shard_id].table;
+
+        for (size_t bucket_id = 0; bucket_id < shard->bucket_count; ++bucket_id) {
+            HashBucket* bucket = &shard->contents[bucket_id];
+            const HT_ELEM_T* keys = HashBucket_keys(bucket);
+            void* values = HashBucket_values(bucket);
+
+            for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id) {
+                hash_t hash = hash_elem(task->result->hash_fn, &keys[elem_id]);
+                size_t range_id = _HashTable_bucket_id(task->result, hash) * task->thread_count / task->result->bucket_count;
+
+                if (!stage) {
+                    ++counts[range_id];
+                    continue;
+                }
+
+                size_t index = counts[range_id]++;
+                task->staged_hashes[index] = hash;
+                task->staged_keys[index] = keys[elem_id];
+                task->staged_values[index] = value_at(values, elem_id);
+            }
+        }
+    }
+}
+
+static void* _ShardedTable_stage_count_routine(void* arg) {
+    _ShardTask* task = (_ShardTask*) arg;
+
+    //* Shards are only read from now on, so their threads finish their migration first.
+    for (size_t shard_id = task->thread_id; shard_id < SHARD_COUNT; shard_id += task->thread_count) {
+        HashTable* shard = &task->table->shards[shard_id].table;
+        _HashTable_migrate(shard, shard->old_bucket_count, &task->error);
+    }
+
+    _ShardedTable_stage_elements(task, false);
+
+    return NULL;
+}
+
+static void* _ShardedTable_stage_routine(void* arg) {
+    _ShardedTable_stage_elements((_ShardTask*) arg, true);
+    return NULL;
+}
+
+static void* _ShardedTable_push_routine(void* arg) {
+    _ShardTask* task = (_ShardTask*) arg;
+    const size_t* bounds = task->counts + task->thread_count * task->thread_count;
+
+    for (size_t index = bounds[task->thread_id]; index < bounds[task->thread_id + 1]; ++index) {
+        //* Shard elements are unique, so they are pushed without lookups.
+        HT_ELEM_T key = task->staged_keys[index];
+        if (!KeyArena_store_elem_atomic(&task->result->arena, &key, &task->error)) continue;
+
+        ht_value_t* mapped = _HashTable_push(task->result, task->staged_hashes[index], key, &task->error);
+        if (mapped) memcpy(mapped, task->staged_values[index], HT_VALUE_SIZE);
+    }
+
+    return NULL;
+}
+
+void ShardedTable_ctor(ShardedTable* table, size_t bucket_count, hash_fn_t* hash_fn, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(table, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(bucket_count > 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *table = {};
+
+    int alloc_status = posix_memalign((void**) &table->shards, SHARD_ALIGNMENT, SHARD_COUNT * sizeof(*table->shards));
+    _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, { table->shards = NULL; return; }, err_code, ENOMEM);
+
+    for (size_t shard_id = 0; shard_id < SHARD_COUNT; ++shard_id) table->shards[shard_id] = {};
+
+    size_t shard_bucket_count = (bucket_count + SHARD_COUNT - 1) / SHARD_COUNT;
+
+    for (size_t shard_id = 0; shard_id < SHARD_COUNT; ++shard_id) {
+        HashTable_ctor(&table->shards[shard_id].table, shard_bucket_count, hash_fn, err_code);
+    }
+}
+
+void ShardedTable_dtor(ShardedTable* table) {
+    _LOG_FAIL_CHECK_(table && table->shards, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    for (size_t shard_id = 0; shard_id < SHARD_COUNT; ++shard_id) {
+        if (HashTable_status(&table->shards[shard_id].table) == 0) HashTable_dtor(&table->shards[shard_id].table);
+    }
+
+    free(table->shards);
+    *table = {};
+}
+
+shard_status_t ShardedTable_status(const ShardedTable* table) {
+    if (!table) return SHARD_NULL;
+    if (!table->shards) return SHARD_NO_CONTENT;
+
+    for (size_t shard_id = 0; shard_id < SHARD_COUNT; ++shard_id) {
+        if (HashTable_status(&table->shards[shard_id].table)) return SHARD_BROKEN_SHARD;
+    }
+
+    return 0;
+}
+
+void ShardedTable_build(ShardedTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                        unsigned thread_count, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(ShardedTable_status(table) == 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(count == 0 || (hashes && values), "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(0 < thread_count && thread_count <= SHARD_MAX_THREAD_COUNT, "error", ERROR_REPORTS,
+                     return, err_code, EINVAL);
+
+    //* Per-thread counts are followed by the bounds of the shards.
+    size_t* counts = (size_t*) calloc(thread_count * SHARD_COUNT + SHARD_COUNT + 1, sizeof(*counts));
+    size_t* order = (size_t*) calloc(count + 1, sizeof(*order));
+
+    _LOG_FAIL_CHECK_(counts && order, "error", ERROR_REPORTS, {
+        free(counts);
+        free(order);
+        return;
+    }, err_code, ENOMEM);
+
+    _ShardTask tasks[SHARD_MAX_THREAD_COUNT] = {};
+
+    for (unsigned thread_id = 0; thread_id < thread_count; ++thread_id) {
+        tasks[thread_id] = {};
+        tasks[thread_id].table = table;
+        tasks[thread_id].thread_id = thread_id;
+        tasks[thread_id].thread_count = thread_count;
+        tasks[thread_id].counts = counts;
+        tasks[thread_id].hashes = hashes;
+        tasks[thread_id].values = values;
+        tasks[thread_id].count = count;
+        tasks[thread_id].order = order;
+        tasks[thread_id].comparator = comparator;
+    }
+
+    _ShardedTable_run(_ShardedTable_count_routine, tasks, thread_count);
+    _ShardedTable_offsets(counts, counts + thread_count * SHARD_COUNT, thread_count, SHARD_COUNT);
+    _ShardedTable_run(_ShardedTable_scatter_routine, tasks, thread_count);
+    _ShardedTable_run(_ShardedTable_insert_routine, tasks, thread_count);
+    _ShardedTable_merge_errors(tasks, thread_count, err_code);
+
+    free(counts);
+    free(order);
+
+    table->size = 0;
+    for (size_t shard_id = 0; shard_id < SHARD_COUNT; ++shard_id) table->size += table->shards[shard_id].table.size;
+}
+
+void ShardedTable_merge(ShardedTable* table, HashTable* result, size_t bucket_count, hash_fn_t* hash_fn,
+                        unsigned thread_count, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(ShardedTable_status(table) == 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(result && hash_fn, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(0 < thread_count && thread_count <= SHARD_MAX_THREAD_COUNT, "error", ERROR_REPORTS,
+                     return, err_code, EINVAL);
+
+    HashTable_ctor(result, bucket_count, hash_fn, err_code);
+    if (HashTable_status(result)) return;
+
+    //* The result is sized to fit all elements, so pushes never start a rehash.
+    if (HT_MAX_LOAD_FACTOR && table->size > result->bucket_count * HT_MAX_LOAD_FACTOR) {
+        size_t new_bucket_count = result->bucket_count;
+        while (table->size > new_bucket_count * HT_MAX_LOAD_FACTOR) new_bucket_count *= HT_GROWTH_FACTOR;
+
+        _HashTable_resize(result, _HashTable_fit_bucket_count(result, new_bucket_count), err_code);
+        _HashTable_migrate(result, result->old_bucket_count, err_code);
+    }
+
+    //* Per-thread counts are followed by the bounds of the bucket ranges.
+    size_t* counts = (size_t*) calloc(thread_count * thread_count + thread_count + 1, sizeof(*counts));
+    hash_t* staged_hashes = (hash_t*) calloc(table->size + 1, sizeof(*staged_hashes));
+    HT_ELEM_T* staged_keys = NULL;
+    int alloc_status = posix_memalign((void**) &staged_keys, 32, (table->size + 1) * sizeof(*staged_keys));
+    const void** staged_values = (const void**) calloc(table->size + 1, sizeof(*staged_values));
+
+    _LOG_FAIL_CHECK_(counts && staged_hashes && alloc_status == 0 && staged_values, "error", ERROR_REPORTS, {
+        free(counts);
+        free(staged_hashes);
+        if (alloc_status == 0) free(staged_keys);
+        free(staged_values);
+        return;
+    }, err_code, ENOMEM);
+
+    _ShardTask tasks[SHARD_MAX_THREAD_COUNT] = {};
+
+    for (unsigned thread_id = 0; thread_id < thread_count; ++thread_id) {
+        tasks[thread_id] = {};
+        tasks[thread_id].table = table;
+        tasks[thread_id].thread_id = thread_id;
+        tasks[thread_id].thread_count = thread_count;
+        tasks[thread_id].counts = counts;
+        tasks[thread_id].result = result;
+        tasks[thread_id].staged_hashes = staged_hashes;
+        tasks[thread_id].staged_keys = staged_keys;
+        tasks[thread_id].staged_values = staged_values;
+    }
+
+    _ShardedTable_run(_ShardedTable_stage_count_routine, tasks, thread_count);
+    _ShardedTable_offsets(counts, counts + thread_count * thread_count, thread_count, thread_count);
+    _ShardedTable_run(_ShardedTable_stage_routine, tasks, thread_count);
+    _ShardedTable_run(_ShardedTable_push_routine, tasks, thread_count);
+    _ShardedTable_merge_errors(tasks, thread_count, err_code);
+
+    free(counts);
+    free(staged_hashes);
+    free(staged_keys);
+    free(staged_values);
+
+    result->size = table->size;
+}
+
+void ShardedTable_insert(ShardedTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    ShardedTable_upsert(table, hash, value, comparator, err_code);
+}
+
+ht_value_t* ShardedTable_upsert(ShardedTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator,
+                                err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(table && table->shards, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+
+    HashTable* shard = &table->shards[_ShardedTable_shard_id(hash)].table;
+
+    size_t shard_size = shard->size;
+    ht_value_t* mapped = HashTable_upsert(shard, hash, value, comparator, err_code);
+    table->size += shard->size - shard_size;
+
+    return mapped;
+}
+
+bool ShardedTable_erase(ShardedTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(table && table->shards, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    bool found = HashTable_erase(&table->shards[_ShardedTable_shard_id(hash)].table, hash, value, comparator, err_code);
+    if (found) --table->size;
+
+    return found;
+}
+
+HT_ELEM_T* ShardedTable_find_value(ShardedTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(table && table->shards, "error", ERROR_REPORTS, return NULL, NULL, EINVAL);
+    return HashTable_find_value(&table->shards[_ShardedTable_shard_id(hash)].table, hash, value, comparator);
+}
+
+void ShardedTable_find_batch(ShardedTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                             HT_ELEM_T** results, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(table && table->shards, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(count == 0 || (hashes && values && results), "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    //* Lookups do not advance migration of the shards, so all results stay valid until the next access.
+    for (size_t id = 0; id < count; ++id) {
+        if (id + HT_BATCH_GROUP < count) {
+            HashTable* shard = &table->shards[_ShardedTable_shard_id(hashes[id + HT_BATCH_GROUP])].table;
+            _HashTable_prefetch_header(&shard->contents[_HashTable_bucket_id(shard, hashes[id + HT_BATCH_GROUP])]);
+        }
+
+        results[id] = _HashTable_lookup(&table->shards[_ShardedTable_shard_id(hashes[id])].table, hashes[id], values[id],
+                                        comparator);
+    }
+}
+
+size_t ShardedTable_bucket_count(const ShardedTable* table) {
+    _LOG_FAIL_CHECK_(table && table->shards, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    size_t bucket_count = 0;
+    for (size_t shard_id = 0; shard_id < SHARD_COUNT; ++shard_id) bucket_count += HashTable_bucket_count(&table->shards[shard_id].table);
+
+    return bucket_count;
+}
+
+size_t ShardedTable_bucket_size(const ShardedTable* table, size_t bucket_id) {
+    _LOG_FAIL_CHECK_(table && table->shards, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    for (size_t shard_id = 0; shard_id < SHARD_COUNT; ++shard_id) {
+        size_t shard_bucket_count = HashTable_bucket_count(&table->shards[shard_id].table);
+        if (bucket_id < shard_bucket_count) return HashTable_bucket_size(&table->shards[shard_id].table, bucket_id);
+
+        bucket_id -= shard_bucket_count;
+    }
+
+    _LOG_FAIL_CHECK_(false, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,460 @@
+/**
+ * @file swiss_table.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Open-addressing hash table with SIMD-scanned control bytes.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef SWISS_TABLE_HPP
+#define SWISS_TABLE_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "src/utils/config.h"
+
+#include "table_elem.h"
+#include "key_arena.hpp"
+
+//* Slots are split into groups, control bytes of the whole group are checked with a single AVX2 compare.
+static const size_t SWISS_GROUP_SIZE = 32;
+
+//* Control byte states. Full slots store 7 lower bits of the hash (sign bit is always clear).
+static const int8_t SWISS_EMPTY   = (int8_t) 0x80;
+static const int8_t SWISS_DELETED = (int8_t) 0xFE;
+
+//* Max load factor of the table is SWISS_MAX_LOAD_NUM / SWISS_MAX_LOAD_DEN.
+static const size_t SWISS_MAX_LOAD_NUM = 7;
+static const size_t SWISS_MAX_LOAD_DEN = 8;
+
+//* The table shrinks twice when its load factor drops below 1 / SWISS_SHRINK_DIVISOR.
+static const size_t SWISS_SHRINK_DIVISOR = 8;
+
+//* Number of keys batched lookup prefetches at once.
+static const size_t SWISS_BATCH_GROUP = 16;
+
+typedef unsigned swiss_status_t;
+
+enum SWISS_STATUS {
+    SWISS_NULL          = 1 << 0,
+    SWISS_NO_CONTENT    = 1 << 1,
+    SWISS_BAD_CAPACITY  = 1 << 2,
+    SWISS_BIG_SIZE      = 1 << 3,
+};
+
+/**
+ * @brief Open-addressing hash table.
+ *
+ * @param size number of stored elements
+ * @param deleted number of slots marked as deleted
+ * @param min_capacity initial number of slots (the table never shrinks below it)
+ * @param capacity number of slots (power of two, multiple of SWISS_GROUP_SIZE)
+ * @param control control byte of each slot
+ * @param slots element storage followed by the values of the elements
+ * @param hash_fn function used to recalculate hashes on table growth
+ * @param arena storage of the long keys (keys of erased elements are only released with the table)
+ */
+struct SwissTable {
+    size_t size = 0;
+    size_t deleted = 0;
+    size_t min_capacity = 0;
+    size_t capacity = 0;
+    int8_t* control = NULL;
+    HT_ELEM_T* slots = NULL;
+    hash_fn_t* hash_fn = NULL;
+    KeyArena arena = {};
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Construct swiss table data structure
+ *
+ * @param table pointer to the table
+ * @param bucket_count initial number of slot groups (rounded up to a power of two)
+ * @param hash_fn hash function the table is going to be used with
+ * @param err_code pointer to the errno-functioning variable
+ */
+void SwissTable_ctor(SwissTable* table, size_t bucket_count, hash_fn_t* hash_fn, ERROR_MARKER);
+
+/**
+ * @brief Destroy the table
+ *
+ * @param table pointer to the table to destroy
+ */
+void SwissTable_dtor(SwissTable* table);
+
+/**
+ * @brief Get status of the table
+ *
+ * @param table pointer to the table
+ * @return swiss_status_t
+ */
+swiss_status_t SwissTable_status(const SwissTable* table);
+
+/**
+ * @brief Insert an element
+ *
+ * @param table pointer to the table
+ * @param hash hash of the new element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ */
+void SwissTable_insert(SwissTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t comparator, ERROR_MARKER);
+
+/**
+ * @brief Find an element or insert it if it is not in the table
+ *
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return pointer to the value mapped to the element (zero-initialized for new elements, NULL on failure),
+ *         valid until the next insertion or erasure
+ */
+ht_value_t* SwissTable_upsert(SwissTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Remove an element from the table
+ *
+ * @param table pointer to the table
+ * @param hash hash of the element
+ * @param value value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the element was present in the table
+ */
+bool SwissTable_erase(SwissTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, ERROR_MARKER);
+
+/**
+ * @brief Find element in the table by its hash and value
+ *
+ * @param table table to search in
+ * @param hash hash of the element
+ * @param value exact value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @return pointer to the element slot in the table (NULL if the element was not found)
+ */
+HT_ELEM_T* SwissTable_find_value(const SwissTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Find several elements in the table, prefetching their groups ahead of time
+ *
+ * @param table table to search in
+ * @param hashes hashes of the elements
+ * @param values exact values of the elements
+ * @param count number of elements to search for
+ * @param results array the pointers to the found slots are written to (NULL for absent elements)
+ * @param comparator comparator function between elements (should return 0 on equality)
+ */
+void SwissTable_find_batch(const SwissTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                           HT_ELEM_T** results, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Get the number of slot groups in the table
+ *
+ * @param table
+ * @return size_t
+ */
+size_t SwissTable_bucket_count(const SwissTable* table);
+
+/**
+ * @brief Get the number of elements stored in the specified slot group
+ *
+ * @param table
+ * @param bucket_id index of the group
+ * @return size_t
+ */
+size_t SwissTable_bucket_size(const SwissTable* table, size_t bucket_id);
+
+
+//* IMPLEMENTATIONS ==============================
+
+static inline int8_t _SwissTable_h2(hash_t hash) { return (int8_t) (hash & 0x7F); }
+static inline size_t _SwissTable_h1(hash_t hash) { return (size_t) (hash >> 7); }
+
+/**
+ * @brief Get bit mask of slots in the group whose control byte equals the specified one.
+ */
+static inline unsigned _SwissTable_match(const int8_t* group, int8_t byte) {
+    __m256i control = _mm256_load_si256((const __m256i*) group);
+    return (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(control, _mm256_set1_epi8(byte)));
+}
+
+/**
+ * @brief Get bit mask of slots in the group that are either empty or deleted (both have their sign bit set).
+ */
+static inline unsigned _SwissTable_match_free(const int8_t* group) {
+    return (unsigned) _mm256_movemask_epi8(_mm256_load_si256((const __m256i*) group));
+}
+
+/**
+ * @brief Get the array of values, stored right after the slots.
+ */
+static inline void* _SwissTable_values(const SwissTable* table) {
+    return table->slots + table->capacity;
+}
+
+static void _SwissTable_allocate(SwissTable* table, size_t capacity, err_anchor_t err_code) {
+    table->control = NULL;
+    table->slots = NULL;
+
+    int ctrl_status = posix_memalign((void**) &table->control, SWISS_GROUP_SIZE, capacity * sizeof(*table->control));
+    int slot_status = posix_memalign((void**) &table->slots, 32, capacity * (sizeof(*table->slots) + HT_VALUE_SIZE));
+
+    if (ctrl_status != 0 || slot_status != 0) {
+        free(table->control);
+        free(table->slots);
+        table->control = NULL;
+        table->slots = NULL;
+        if (err_code) *err_code = ENOMEM;
+        return;
+    }
+
+    memset(table->control, SWISS_EMPTY, capacity * sizeof(*table->control));
+    table->capacity = capacity;
+    table->size = 0;
+    table->deleted = 0;
+}
+
+/**
+ * @brief Find a free slot on the probe sequence of the hash.
+ */
+static size_t _SwissTable_find_free(const SwissTable* table, hash_t hash) {
+    size_t group_mask = table->capacity / SWISS_GROUP_SIZE - 1;
+    size_t group_id = _SwissTable_h1(hash) & group_mask;
+
+    for (size_t step = 1; ; ++step) {
+        unsigned free_mask = _SwissTable_match_free(table->control + group_id * SWISS_GROUP_SIZE);
+        if (free_mask) return group_id * SWISS_GROUP_SIZE + (size_t) __builtin_ctz(free_mask);
+
+        group_id = (group_id + step) & group_mask;
+    }
+}
+
+static void _SwissTable_rehash(SwissTable* table, size_t new_capacity, err_anchor_t err_code) {
+    SwissTable old_table = *table;
+
+    _SwissTable_allocate(table, new_capacity, err_code);
+    if (!table->control) {
+        *table = old_table;
+        return;
+    }
+
+    void* values = _SwissTable_values(table);
+    void* old_values = _SwissTable_values(&old_table);
+
+    for (size_t slot_id = 0; slot_id < old_table.capacity; ++slot_id) {
+        if (old_table.control[slot_id] < 0) continue;
+
+        hash_t hash = hash_elem(table->hash_fn, &old_table.slots[slot_id]);
+        size_t new_slot = _SwissTable_find_free(table, hash);
+
+        table->control[new_slot] = _SwissTable_h2(hash);
+        table->slots[new_slot] = old_table.slots[slot_id];
+        memcpy(value_at(values, new_slot), value_at(old_values, slot_id), HT_VALUE_SIZE);
+    }
+
+    table->size = old_table.size;
+
+    free(old_table.control);
+    free(old_table.slots);
+}
+
+void SwissTable_ctor(SwissTable* table, size_t bucket_count, hash_fn_t* hash_fn, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(table, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(hash_fn, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *table = {};
+    table->hash_fn = hash_fn;
+
+    size_t group_count = 1;
+    while (group_count < bucket_count) group_count *= 2;
+
+    _SwissTable_allocate(table, group_count * SWISS_GROUP_SIZE, err_code);
+    table->min_capacity = table->capacity;
+}
+
+void SwissTable_dtor(SwissTable* table) {
+    _LOG_FAIL_CHECK_(SwissTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    free(table->control);
+    free(table->slots);
+
+    KeyArena_dtor(&table->arena);
+
+    *table = {};
+}
+
+swiss_status_t SwissTable_status(const SwissTable* table) {
+    if (!table) return SWISS_NULL;
+    if (!table->control || !table->slots) return SWISS_NO_CONTENT;
+
+    swiss_status_t status = 0;
+
+    if (table->capacity < SWISS_GROUP_SIZE || (table->capacity & (table->capacity - 1)))
+        status |= SWISS_BAD_CAPACITY;
+    if (table->size + table->deleted > table->capacity) status |= SWISS_BIG_SIZE;
+
+    return status;
+}
+
+void SwissTable_insert(SwissTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t comparator, err_anchor_t err_code) {
+    SwissTable_upsert(table, hash, value, comparator, err_code);
+}
+
+ht_value_t* SwissTable_upsert(SwissTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator,
+                              err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(SwissTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+
+    HT_ELEM_T* found = SwissTable_find_value(table, hash, value, comparator);
+    if (found) return value_at(_SwissTable_values(table), (size_t) (found - table->slots));
+
+    if (!KeyArena_store_elem(&table->arena, &value, err_code)) return NULL;
+
+    size_t slot_id = _SwissTable_find_free(table, hash);
+
+    //* Reusing a deleted slot does not change the load of the table.
+    if (table->control[slot_id] == SWISS_EMPTY &&
+        (table->size + table->deleted + 1) * SWISS_MAX_LOAD_DEN > table->capacity * SWISS_MAX_LOAD_NUM) {
+
+        //* Table full of tombstones is cleaned up without growing.
+        size_t new_capacity = table->size * 2 < table->capacity ? table->capacity : table->capacity * 2;
+        _SwissTable_rehash(table, new_capacity, err_code);
+        slot_id = _SwissTable_find_free(table, hash);
+    }
+
+    if (table->control[slot_id] == SWISS_DELETED) --table->deleted;
+
+    table->control[slot_id] = _SwissTable_h2(hash);
+    table->slots[slot_id] = value;
+
+    ht_value_t* mapped = value_at(_SwissTable_values(table), slot_id);
+    memset(mapped, 0, HT_VALUE_SIZE);
+
+    ++table->size;
+
+    return mapped;
+}
+
+bool SwissTable_erase(SwissTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(SwissTable_status(table) == 0, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    HT_ELEM_T* slot = SwissTable_find_value(table, hash, value, comparator);
+    if (!slot) return false;
+
+    size_t slot_id = (size_t) (slot - table->slots);
+    const int8_t* group = table->control + slot_id / SWISS_GROUP_SIZE * SWISS_GROUP_SIZE;
+
+    //* Probing only continues past groups without empty slots, so in any other group the slot can be freed completely.
+    if (_SwissTable_match(group, SWISS_EMPTY)) {
+        table->control[slot_id] = SWISS_EMPTY;
+    } else {
+        table->control[slot_id] = SWISS_DELETED;
+        ++table->deleted;
+    }
+
+    --table->size;
+
+    if (table->capacity > table->min_capacity && table->size * SWISS_SHRINK_DIVISOR < table->capacity) {
+        _SwissTable_rehash(table, table->capacity / 2, err_code);
+    }
+
+    return true;
+}
+
+HT_ELEM_T* SwissTable_find_value(const SwissTable* table, hash_t hash, HT_ELEM_T value, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(SwissTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, NULL, EINVAL);
+
+    size_t group_mask = table->capacity / SWISS_GROUP_SIZE - 1;
+    size_t group_id = _SwissTable_h1(hash) & group_mask;
+    int8_t h2 = _SwissTable_h2(hash);
+
+    for (size_t step = 1; step <= group_mask + 1; ++step) {
+        const int8_t* group = table->control + group_id * SWISS_GROUP_SIZE;
+        HT_ELEM_T* group_slots = table->slots + group_id * SWISS_GROUP_SIZE;
+
+        for (unsigned match = _SwissTable_match(group, h2); match; match &= match - 1) {
+            HT_ELEM_T* slot = group_slots + __builtin_ctz(match);
+            if (elem_equal(*slot, value, comparator)) return slot;
+        }
+
+        if (_SwissTable_match(group, SWISS_EMPTY)) return NULL;
+
+        group_id = (group_id + step) & group_mask;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Request home groups of the group of elements from memory.
+ */
+static void _SwissTable_prefetch_control(const SwissTable* table, const hash_t* hashes, size_t first, size_t count) {
+    size_t group_mask = table->capacity / SWISS_GROUP_SIZE - 1;
+
+    for (size_t id = first; id < first + SWISS_BATCH_GROUP && id < count; ++id) {
+        size_t group_id = _SwissTable_h1(hashes[id]) & group_mask;
+        _mm_prefetch((const char*) (table->control + group_id * SWISS_GROUP_SIZE), _MM_HINT_T0);
+    }
+}
+
+/**
+ * @brief Request the first candidate slot of each element from memory (control bytes should already be requested).
+ */
+static void _SwissTable_prefetch_slots(const SwissTable* table, const hash_t* hashes, size_t first, size_t count) {
+    size_t group_mask = table->capacity / SWISS_GROUP_SIZE - 1;
+
+    for (size_t id = first; id < first + SWISS_BATCH_GROUP && id < count; ++id) {
+        size_t group_id = _SwissTable_h1(hashes[id]) & group_mask;
+        unsigned match = _SwissTable_match(table->control + group_id * SWISS_GROUP_SIZE, _SwissTable_h2(hashes[id]));
+
+        if (match) {
+            _mm_prefetch((const char*) (table->slots + group_id * SWISS_GROUP_SIZE + __builtin_ctz(match)), _MM_HINT_T0);
+        }
+    }
+}
+
+void SwissTable_find_batch(const SwissTable* table, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                           HT_ELEM_T** results, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(SwissTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(count == 0 || (hashes && values && results), "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    //* Control bytes of one group, candidate slots of the previous group and the elements of the group
+    //* before it are requested in the same pass, so lookups find their cache lines already loaded.
+    for (size_t group = 0; group < count + 2 * SWISS_BATCH_GROUP; group += SWISS_BATCH_GROUP) {
+        _SwissTable_prefetch_control(table, hashes, group, count);
+
+        if (group >= SWISS_BATCH_GROUP) _SwissTable_prefetch_slots(table, hashes, group - SWISS_BATCH_GROUP, count);
+
+        if (group < 2 * SWISS_BATCH_GROUP) continue;
+
+        size_t first = group - 2 * SWISS_BATCH_GROUP;
+        for (size_t id = first; id < first + SWISS_BATCH_GROUP && id < count; ++id) {
+            results[id] = SwissTable_find_value(table, hashes[id], values[id], comparator);
+        }
+    }
+}
+
+size_t SwissTable_bucket_count(const SwissTable* table) {
+    _LOG_FAIL_CHECK_(SwissTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    return table->capacity / SWISS_GROUP_SIZE;
+}
+
+size_t SwissTable_bucket_size(const SwissTable* table, size_t bucket_id) {
+    _LOG_FAIL_CHECK_(SwissTable_status(table) == 0, "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(bucket_id < SwissTable_bucket_count(table), "error", ERROR_REPORTS, return 0, NULL, EINVAL);
+
+    unsigned free_mask = _SwissTable_match_free(table->control + bucket_id * SWISS_GROUP_SIZE);
+    return SWISS_GROUP_SIZE - (size_t) __builtin_popcount(free_mask);
+}
+
+#endif
@@ -0,0 +1,303 @@
+/**
+ * @file table_elem.h
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Element type shared by all hash table engines.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef TABLE_ELEM_H
+#define TABLE_ELEM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "hash.h"
+#include "hash_functions.h"
+
+#include "lib/util/dbg/debug.h"
+
+#include "src/utils/config.h"
+
+#if OPTIMIZATION_LEVEL < 1
+typedef const char* HT_ELEM_T;
+const HT_ELEM_T HT_ELEM_POISON = NULL;
+#else
+typedef __m256i HT_ELEM_T __attribute__((__aligned__(32)));
+const HT_ELEM_T HT_ELEM_POISON = _mm256_set1_epi8(0);
+#endif
+
+typedef int ht_compar_fn_t(HT_ELEM_T alpha, HT_ELEM_T beta);
+
+#ifdef HT_VALUE_T
+//* Map mode: every element is stored together with a value of this type.
+typedef HT_VALUE_T ht_value_t;
+static const size_t HT_VALUE_SIZE = sizeof(ht_value_t);
+#else
+//* Set mode: values take no space, so pointers to them should never be dereferenced.
+typedef unsigned char ht_value_t;
+static const size_t HT_VALUE_SIZE = 0;
+#endif
+
+/**
+ * @brief Get value by its index in the array of values.
+ *
+ * @param values array of values
+ * @param index
+ * @return ht_value_t*
+ */
+static inline ht_value_t* value_at(void* values, size_t index) {
+    return (ht_value_t*) ((char*) values + index * HT_VALUE_SIZE);
+}
+
+//* Keys up to this length are short, longer keys are copied to the key arena of the table.
+static const size_t HT_KEY_INLINE_LENGTH = MAX_WORD_LENGTH - 1;
+
+#if OPTIMIZATION_LEVEL >= 1
+//* Element of the long key consists of the first HT_KEY_PREFIX_LENGTH bytes of the key,
+//* pointer to the whole key (bytes 16-23), its length (bytes 24-27) and HT_KEY_LONG_MARKER in the last byte.
+//* Short keys are stored as is and padded with zeros.
+static const size_t HT_KEY_PREFIX_LENGTH = 16;
+static const int HT_KEY_LONG_MARKER = 0xFF;
+
+//* Movemask bits of the key pointer bytes.
+static const unsigned HT_KEY_POINTER_BYTES = 0x00FF0000u;
+#endif
+
+/**
+ * @brief Make element out of the key.
+ *
+ * The key is not copied, so the memory should stay valid until the element is inserted.
+ *
+ * @param data key (should be followed by a null character on OPTIMIZATION_LEVEL 0)
+ * @param length length of the key
+ * @return HT_ELEM_T
+ */
+static inline HT_ELEM_T elem_make(const char* data, size_t length) {
+    #if OPTIMIZATION_LEVEL < 1
+    SILENCE_UNUSED(length);
+    return data;
+    #else
+    char buffer[MAX_WORD_LENGTH] __attribute__((__aligned__(32))) = "";
+    memcpy(buffer, data, length <= HT_KEY_INLINE_LENGTH ? length : HT_KEY_PREFIX_LENGTH);
+
+    HT_ELEM_T elem = _mm256_load_si256((const __m256i*) buffer);
+    if (length <= HT_KEY_INLINE_LENGTH) return elem;
+
+    elem = _mm256_insert_epi64(elem, (long long) data, 2);
+    return _mm256_insert_epi64(elem, (long long) (length | (uint64_t) HT_KEY_LONG_MARKER << 56), 3);
+    #endif
+}
+
+/**
+ * @brief Check if the element refers to the key outside of it.
+ *
+ * @param elem
+ * @return true if the key is longer than HT_KEY_INLINE_LENGTH
+ */
+static inline bool elem_is_long(const HT_ELEM_T* elem) {
+    #if OPTIMIZATION_LEVEL < 1
+    return strlen(*elem) > HT_KEY_INLINE_LENGTH;
+    #else
+    return _mm256_extract_epi8(*elem, 31) == HT_KEY_LONG_MARKER;
+    #endif
+}
+
+/**
+ * @brief Get the key the element refers to.
+ *
+ * @param elem
+ * @return const char*
+ */
+static inline const char* elem_data(const HT_ELEM_T* elem) {
+    #if OPTIMIZATION_LEVEL < 1
+    return *elem;
+    #else
+    if (elem_is_long(elem)) return (const char*) _mm256_extract_epi64(*elem, 2);
+    return (const char*) elem;
+    #endif
+}
+
+/**
+ * @brief Get length of the key the element refers to.
+ *
+ * @param elem
+ * @return size_t
+ */
+static inline size_t elem_length(const HT_ELEM_T* elem) {
+    #if OPTIMIZATION_LEVEL < 1
+    return strlen(*elem);
+    #else
+    if (elem_is_long(elem)) return (uint32_t) _mm256_extract_epi32(*elem, 6);
+    return strnlen((const char*) elem, HT_KEY_INLINE_LENGTH);
+    #endif
+}
+
+/**
+ * @brief Calculate hash of the long key without reading past its end.
+ *
+ * Hash functions may read whole words, so the full words of the key are hashed in place,
+ * and the hash of them is hashed once more together with the zero-padded tail.
+ * The hash only depends on the key itself, whether it lies in the caller's buffer or in the arena.
+ *
+ * @param hash_fn hash function
+ * @param data key
+ * @param length key length
+ * @return hash_t
+ */
+static inline hash_t _hash_long_key(hash_fn_t* hash_fn, const char* data, size_t length) {
+    size_t head_length = length - length % sizeof(hash_t);
+    hash_t head_hash = hash_fn(data, data + head_length);
+    if (head_length == length) return head_hash;
+
+    hash_t block[2] = {head_hash, 0};
+    memcpy(&block[1], data + head_length, length - head_length);
+    return hash_fn(block, block + 2);
+}
+
+/**
+ * @brief Seeded version of _hash_long_key.
+ *
+ * @param hash_fn seeded hash function
+ * @param seed
+ * @param data key
+ * @param length key length
+ * @return hash_t
+ */
+static inline hash_t _hash_long_key_seeded(seeded_hash_fn_t* hash_fn, const HashSeed* seed, const char* data, size_t length) {
+    size_t head_length = length - length % sizeof(hash_t);
+    hash_t head_hash = hash_fn(data, data + head_length, seed);
+    if (head_length == length) return head_hash;
+
+    hash_t block[2] = {head_hash, 0};
+    memcpy(&block[1], data + head_length, length - head_length);
+    return hash_fn(block, block + 2, seed);
+}
+
+/**
+ * @brief Calculate hash of the element the same way the test engine does.
+ *
+ * Short keys are hashed as MAX_WORD_LENGTH-byte zero-padded blocks, long keys are hashed with _hash_long_key.
+ *
+ * @param hash_fn hash function
+ * @param elem pointer to the element
+ * @return hash_t
+ */
+static inline hash_t hash_elem(hash_fn_t* hash_fn, const HT_ELEM_T* elem) {
+    #if OPTIMIZATION_LEVEL < 1
+    size_t length = strlen(*elem);
+    if (length <= HT_KEY_INLINE_LENGTH) return hash_fn(*elem, *elem + MAX_WORD_LENGTH);
+    return _hash_long_key(hash_fn, *elem, length);
+    #else
+    if (!elem_is_long(elem)) return hash_fn(elem, elem + 1);
+
+    return _hash_long_key(hash_fn, elem_data(elem), elem_length(elem));
+    #endif
+}
+
+/**
+ * @brief Calculate hash of the element under the seed, covering the same bytes as hash_elem.
+ *
+ * @param hash_fn seeded hash function
+ * @param seed
+ * @param elem pointer to the element
+ * @return hash_t
+ */
+static inline hash_t hash_elem_seeded(seeded_hash_fn_t* hash_fn, const HashSeed* seed, const HT_ELEM_T* elem) {
+    #if OPTIMIZATION_LEVEL < 1
+    size_t length = strlen(*elem);
+    if (length <= HT_KEY_INLINE_LENGTH) return hash_fn(*elem, *elem + MAX_WORD_LENGTH, seed);
+    return _hash_long_key_seeded(hash_fn, seed, *elem, length);
+    #else
+    if (!elem_is_long(elem)) return hash_fn(elem, elem + 1, seed);
+
+    return _hash_long_key_seeded(hash_fn, seed, elem_data(elem), elem_length(elem));
+    #endif
+}
+
+#if OPTIMIZATION_LEVEL >= 1
+/**
+ * @brief Finish comparison of two elements given the movemask of their equal bytes.
+ *
+ * @return 0 if elements are equal
+ */
+static inline int _elem_compare_tail(HT_ELEM_T alpha, HT_ELEM_T beta, unsigned equal) {
+    if (equal == ~0u) return 0;
+
+    //* Elements of equal long keys can only differ in their key pointers, any other mismatch is final.
+    if ((equal | HT_KEY_POINTER_BYTES) != ~0u || !elem_is_long(&alpha)) return 1;
+
+    return memcmp(elem_data(&alpha) + HT_KEY_PREFIX_LENGTH, elem_data(&beta) + HT_KEY_PREFIX_LENGTH,
+                  elem_length(&alpha) - HT_KEY_PREFIX_LENGTH);
+}
+
+/**
+ * @brief Compare elements byte by byte with AVX2 (the baseline of the build).
+ *
+ * @param alpha
+ * @param beta
+ * @return 0 if elements are equal
+ */
+static inline int elem_compare_avx2(HT_ELEM_T alpha, HT_ELEM_T beta) {
+    return _elem_compare_tail(alpha, beta, (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(alpha, beta)));
+}
+
+/**
+ * @brief Compare elements byte by byte with AVX-512, which writes the byte mask straight into a mask register.
+ *
+ * @param alpha
+ * @param beta
+ * @return 0 if elements are equal
+ */
+__attribute__((__target__("avx512bw,avx512vl")))
+static inline int elem_compare_avx512(HT_ELEM_T alpha, HT_ELEM_T beta) {
+    return _elem_compare_tail(alpha, beta, _mm256_cmpeq_epi8_mask(alpha, beta));
+}
+
+static inline ht_compar_fn_t* _elem_pick_comparator() {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) return elem_compare_avx512;
+    return elem_compare_avx2;
+}
+#endif
+
+/**
+ * @brief Get the fastest element comparator the processor supports.
+ *
+ * The choice is made from CPUID on the first call, so the same binary uses AVX-512 where it is available.
+ *
+ * @return comparator returning 0 on equal elements
+ */
+static inline ht_compar_fn_t* elem_comparator() {
+    #if OPTIMIZATION_LEVEL < 1
+    return strcmp;
+    #else
+    static ht_compar_fn_t* const comparator = _elem_pick_comparator();
+    return comparator;
+    #endif
+}
+
+/**
+ * @brief Check if two elements are equal.
+ *
+ * @param alpha
+ * @param beta
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @return true if elements are equal
+ */
+static inline bool elem_equal(HT_ELEM_T alpha, HT_ELEM_T beta, ht_compar_fn_t* comparator) {
+    #if OPTIMIZATION_LEVEL >= 1
+    //* Equal elements are the common case of a lookup, so they are accepted without calling the comparator.
+    __m256i difference = _mm256_xor_si256(alpha, beta);
+    if (_mm256_testz_si256(difference, difference)) return true;
+    #endif
+
+    return comparator(alpha, beta) == 0;
+}
+
+#endif
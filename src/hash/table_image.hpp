@@ -0,0 +1,456 @@
+/**
+ * @file table_image.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Relocatable on-disk image of a hash table queried directly from the mapped file.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef TABLE_IMAGE_HPP
+#define TABLE_IMAGE_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#include "src/utils/config.h"
+#include "src/utils/common_utils.h"
+
+#include "table_elem.h"
+#include "hash_table.hpp"
+
+static const char IMG_MAGIC[8] = "HTIMAGE";
+static const uint32_t IMG_VERSION = 1;
+
+//* Every section of the image starts at a multiple of this alignment.
+static const size_t IMG_ALIGNMENT = 64;
+
+//* Number of elements batched lookup prefetches bucket offsets ahead (tags are prefetched half as far).
+static const size_t IMG_BATCH_DISTANCE = 16;
+
+//* Hash of this block is stored in the image, so the image is never opened with a different hash function.
+static const char IMG_HASH_PROBE[MAX_WORD_LENGTH] __attribute__((__aligned__(32))) = "table image hash probe";
+
+#if OPTIMIZATION_LEVEL < 1
+//* Element of the image is the offset of its null-terminated key in the key data section.
+typedef uint64_t img_elem_t;
+#else
+//* Element of the image is the table element with the offset of the long key in place of its pointer.
+typedef HT_ELEM_T img_elem_t;
+#endif
+
+typedef unsigned img_status_t;
+
+enum IMG_STATUS {
+    IMG_NULL        = 1 << 0,
+    IMG_NO_CONTENT  = 1 << 1,
+};
+
+/**
+ * @brief Header of the image file. All positions are byte offsets from the start of the file.
+ *
+ * @param magic IMG_MAGIC
+ * @param version IMG_VERSION
+ * @param optimization_level OPTIMIZATION_LEVEL the image was written with (defines the element layout)
+ * @param elem_size size of the image element
+ * @param value_size size of the element value
+ * @param hash_check hash of IMG_HASH_PROBE
+ * @param size number of elements
+ * @param bucket_count number of buckets
+ * @param offsets_position position of bucket_count + 1 indices of the first element of every bucket
+ * @param tags_position position of the element tags
+ * @param keys_position position of the elements
+ * @param values_position position of the element values
+ * @param data_position position of the key data
+ * @param data_size size of the key data
+ * @param file_size size of the whole file
+ */
+struct TableImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t optimization_level;
+    uint32_t elem_size;
+    uint32_t value_size;
+    uint64_t hash_check;
+    uint64_t size;
+    uint64_t bucket_count;
+    uint64_t offsets_position;
+    uint64_t tags_position;
+    uint64_t keys_position;
+    uint64_t values_position;
+    uint64_t data_position;
+    uint64_t data_size;
+    uint64_t file_size;
+};
+
+/**
+ * @brief Read-only table mapped from the image file.
+ *
+ * Elements of the bucket are stored contiguously, buckets follow each other in the order of their indices.
+ *
+ * @param size number of stored elements
+ * @param bucket_count number of buckets
+ * @param bucket_mod precomputed reduction of hashes modulo bucket_count
+ * @param offsets index of the first element of every bucket (bucket_count + 1 entries)
+ * @param tags element tags
+ * @param keys elements
+ * @param values element values (empty in set mode)
+ * @param data key data
+ * @param map mapping of the file
+ */
+struct TableImage {
+    size_t size = 0;
+    size_t bucket_count = 0;
+    FastMod bucket_mod = {};
+    const uint64_t* offsets = NULL;
+    const ht_tag_t* tags = NULL;
+    const img_elem_t* keys = NULL;
+    const char* values = NULL;
+    const char* data = NULL;
+    MmapResult map = {};
+};
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Write image of the table to the file
+ *
+ * @param table table to save (should have a hash function, its migration is finished)
+ * @param name name of the file
+ * @param err_code pointer to the errno-functioning variable
+ */
+void HashTable_save(HashTable* table, const char* name, ERROR_MARKER);
+
+/**
+ * @brief Map the image file and prepare it for lookups
+ *
+ * Only the header is validated, contents of the file are trusted.
+ *
+ * @param image pointer to the image to construct
+ * @param name name of the file
+ * @param hash_fn hash function the image was saved with
+ * @param err_code pointer to the errno-functioning variable
+ */
+void TableImage_open(TableImage* image, const char* name, hash_fn_t* hash_fn, ERROR_MARKER);
+
+/**
+ * @brief Unmap the image
+ *
+ * @param image pointer to the image to close
+ */
+void TableImage_close(TableImage* image);
+
+/**
+ * @brief Get status of the image
+ *
+ * @param image pointer to the image
+ * @return img_status_t
+ */
+img_status_t TableImage_status(const TableImage* image);
+
+/**
+ * @brief Find element in the image by its hash and value
+ *
+ * @param image image to search in (should be successfully opened)
+ * @param hash hash of the element
+ * @param value exact value of the element
+ * @param comparator comparator function between elements (should return 0 on equality)
+ * @return pointer to the image element (NULL if the element was not found)
+ */
+static inline const img_elem_t* TableImage_find_value(const TableImage* image, hash_t hash, HT_ELEM_T value,
+                                                      ht_compar_fn_t* comparator);
+
+/**
+ * @brief Find several elements in the image, prefetching their buckets ahead of time
+ *
+ * @param image image to search in
+ * @param hashes hashes of the elements
+ * @param values exact values of the elements
+ * @param count number of elements to search for
+ * @param results array the pointers to the found elements are written to (NULL for absent elements)
+ * @param comparator comparator function between elements (should return 0 on equality)
+ */
+void TableImage_find_batch(const TableImage* image, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                           const img_elem_t** results, ht_compar_fn_t* comparator);
+
+/**
+ * @brief Get the value of the element found in the image
+ *
+ * @param image image
+ * @param cell element returned by the lookup
+ * @return pointer to the value of the element
+ */
+static inline const ht_value_t* TableImage_value(const TableImage* image, const img_elem_t* cell);
+
+
+//* IMPLEMENTATIONS ==============================
+
+static inline size_t _TableImage_align(size_t position) {
+    return (position + IMG_ALIGNMENT - 1) / IMG_ALIGNMENT * IMG_ALIGNMENT;
+}
+
+static inline bool _TableImage_equal(const TableImage* image, const img_elem_t* cell, HT_ELEM_T value,
+                                     ht_compar_fn_t* comparator) {
+    #if OPTIMIZATION_LEVEL < 1
+    return comparator(image->data + *cell, value) == 0;
+    #else
+    SILENCE_UNUSED(comparator);
+    unsigned equal = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(*cell, value));
+
+    //* Long keys can only match if everything except their offset and pointer is equal.
+    if ((equal | HT_KEY_POINTER_BYTES) != ~0u) return false;
+    if (!elem_is_long(cell)) return equal == ~0u;
+
+    return memcmp(image->data + _mm256_extract_epi64(*cell, 2) + HT_KEY_PREFIX_LENGTH, elem_data(&value) + HT_KEY_PREFIX_LENGTH,
+                  elem_length(&value) - HT_KEY_PREFIX_LENGTH) == 0;
+    #endif
+}
+
+static inline const img_elem_t* _TableImage_find_in_bucket(const TableImage* image, size_t bucket_id, hash_t hash,
+                                                           HT_ELEM_T value, ht_compar_fn_t* comparator) {
+    ht_tag_t tag = _HashTable_tag(hash);
+
+    for (uint64_t elem_id = image->offsets[bucket_id]; elem_id < image->offsets[bucket_id + 1]; ++elem_id) {
+        if (image->tags[elem_id] == tag && _TableImage_equal(image, &image->keys[elem_id], value, comparator)) {
+            return &image->keys[elem_id];
+        }
+    }
+
+    return NULL;
+}
+
+static inline const img_elem_t* TableImage_find_value(const TableImage* image, hash_t hash, HT_ELEM_T value,
+                                                      ht_compar_fn_t* comparator) {
+    return _TableImage_find_in_bucket(image, (size_t) FastMod_reduce(&image->bucket_mod, hash), hash, value, comparator);
+}
+
+static inline const ht_value_t* TableImage_value(const TableImage* image, const img_elem_t* cell) {
+    return (const ht_value_t*) (image->values + (size_t) (cell - image->keys) * HT_VALUE_SIZE);
+}
+
+/**
+ * @brief Get the number of key data bytes the element takes in the image.
+ */
+static inline size_t _TableImage_data_size(const HT_ELEM_T* elem) {
+    #if OPTIMIZATION_LEVEL < 1
+    return elem_length(elem) + 1;
+    #else
+    return elem_is_long(elem) ? elem_length(elem) + 1 : 0;
+    #endif
+}
+
+/**
+ * @brief Write the data and advance the position.
+ */
+static bool _TableImage_write(FILE* file, const void* data, size_t size, size_t* position) {
+    *position += size;
+    return fwrite(data, 1, size, file) == size;
+}
+
+/**
+ * @brief Write zeros up to the next multiple of IMG_ALIGNMENT.
+ */
+static bool _TableImage_pad(FILE* file, size_t* position) {
+    static const char zeros[IMG_ALIGNMENT] = {};
+    return _TableImage_write(file, zeros, _TableImage_align(*position) - *position, position);
+}
+
+/**
+ * @brief Write all sections of the image after the header.
+ */
+static bool _TableImage_write_sections(HashTable* table, FILE* file, const TableImageHeader* header) {
+    size_t position = sizeof(*header);
+    bool written = _TableImage_pad(file, &position);
+
+    uint64_t offset = 0;
+    for (size_t bucket_id = 0; written && bucket_id < table->bucket_count; ++bucket_id) {
+        written = _TableImage_write(file, &offset, sizeof(offset), &position);
+        offset += table->contents[bucket_id].size;
+    }
+    written = written && _TableImage_write(file, &offset, sizeof(offset), &position) && _TableImage_pad(file, &position);
+
+    for (size_t bucket_id = 0; written && bucket_id < table->bucket_count; ++bucket_id) {
+        HashBucket* bucket = &table->contents[bucket_id];
+        written = _TableImage_write(file, HashBucket_tags(bucket), bucket->size * sizeof(ht_tag_t), &position);
+    }
+    written = written && _TableImage_pad(file, &position);
+
+    uint64_t data_offset = 0;
+    for (size_t bucket_id = 0; written && bucket_id < table->bucket_count; ++bucket_id) {
+        HashBucket* bucket = &table->contents[bucket_id];
+        HT_ELEM_T* keys = HashBucket_keys(bucket);
+
+        for (size_t elem_id = 0; written && elem_id < bucket->size; ++elem_id) {
+            #if OPTIMIZATION_LEVEL < 1
+            img_elem_t elem = data_offset;
+            #else
+            img_elem_t elem = keys[elem_id];
+            if (elem_is_long(&elem)) elem = _mm256_insert_epi64(elem, (long long) data_offset, 2);
+            #endif
+
+            written = _TableImage_write(file, &elem, sizeof(elem), &position);
+            data_offset += _TableImage_data_size(&keys[elem_id]);
+        }
+    }
+    written = written && _TableImage_pad(file, &position);
+
+    for (size_t bucket_id = 0; written && bucket_id < table->bucket_count; ++bucket_id) {
+        HashBucket* bucket = &table->contents[bucket_id];
+        written = _TableImage_write(file, HashBucket_values(bucket), bucket->size * HT_VALUE_SIZE, &position);
+    }
+    written = written && _TableImage_pad(file, &position);
+
+    for (size_t bucket_id = 0; written && bucket_id < table->bucket_count; ++bucket_id) {
+        HashBucket* bucket = &table->contents[bucket_id];
+        HT_ELEM_T* keys = HashBucket_keys(bucket);
+
+        for (size_t elem_id = 0; written && elem_id < bucket->size; ++elem_id) {
+            size_t size = _TableImage_data_size(&keys[elem_id]);
+            if (!size) continue;
+
+            written = _TableImage_write(file, elem_data(&keys[elem_id]), size - 1, &position) &&
+                      _TableImage_write(file, "", 1, &position);
+        }
+    }
+
+    return written && position == header->file_size;
+}
+
+void HashTable_save(HashTable* table, const char* name, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(HashTable_status(table) == 0, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(table->hash_fn, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    //* Images do not keep the seed, so buckets of a seeded table could not be found in them.
+    _LOG_FAIL_CHECK_(!table->seeded_hash_fn, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(name, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    _HashTable_migrate(table, table->old_bucket_count, err_code);
+
+    TableImageHeader header = {};
+    memcpy(header.magic, IMG_MAGIC, sizeof(header.magic));
+    header.version = IMG_VERSION;
+    header.optimization_level = OPTIMIZATION_LEVEL;
+    header.elem_size = sizeof(img_elem_t);
+    header.value_size = HT_VALUE_SIZE;
+    header.hash_check = table->hash_fn(IMG_HASH_PROBE, IMG_HASH_PROBE + sizeof(IMG_HASH_PROBE));
+    header.size = table->size;
+    header.bucket_count = table->bucket_count;
+
+    for (size_t bucket_id = 0; bucket_id < table->bucket_count; ++bucket_id) {
+        HashBucket* bucket = &table->contents[bucket_id];
+        HT_ELEM_T* keys = HashBucket_keys(bucket);
+
+        for (size_t elem_id = 0; elem_id < bucket->size; ++elem_id) header.data_size += _TableImage_data_size(&keys[elem_id]);
+    }
+
+    header.offsets_position = _TableImage_align(sizeof(header));
+    header.tags_position = _TableImage_align(header.offsets_position + (header.bucket_count + 1) * sizeof(uint64_t));
+    header.keys_position = _TableImage_align(header.tags_position + header.size * sizeof(ht_tag_t));
+    header.values_position = _TableImage_align(header.keys_position + header.size * sizeof(img_elem_t));
+    header.data_position = _TableImage_align(header.values_position + header.size * HT_VALUE_SIZE);
+    header.file_size = header.data_position + header.data_size;
+
+    FILE* file = fopen(name, "wb");
+    _LOG_FAIL_CHECK_(file, "error", ERROR_REPORTS, return, err_code, ENOENT);
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && _TableImage_write_sections(table, file, &header);
+    written = fclose(file) == 0 && written;
+
+    _LOG_FAIL_CHECK_(written, "error", ERROR_REPORTS, return, err_code, EIO);
+}
+
+void TableImage_open(TableImage* image, const char* name, hash_fn_t* hash_fn, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(image, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(name, "error", ERROR_REPORTS, return, err_code, EINVAL);
+    _LOG_FAIL_CHECK_(hash_fn, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *image = {};
+
+    MmapResult map = map_file(name, O_RDONLY, PROT_READ);
+    _LOG_FAIL_CHECK_(map.ptr, "error", ERROR_REPORTS, return, err_code, ENOENT);
+
+    const TableImageHeader* header = (const TableImageHeader*) map.ptr;
+
+    bool valid = map.size >= sizeof(*header) && memcmp(header->magic, IMG_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == IMG_VERSION && header->optimization_level == OPTIMIZATION_LEVEL &&
+                 header->elem_size == sizeof(img_elem_t) && header->value_size == HT_VALUE_SIZE &&
+                 header->file_size == map.size && header->bucket_count > 0 &&
+                 header->offsets_position + (header->bucket_count + 1) * sizeof(uint64_t) <= header->tags_position &&
+                 header->tags_position + header->size * sizeof(ht_tag_t) <= header->keys_position &&
+                 header->keys_position + header->size * sizeof(img_elem_t) <= header->values_position &&
+                 header->values_position + header->size * HT_VALUE_SIZE <= header->data_position &&
+                 header->data_position + header->data_size <= header->file_size &&
+                 header->keys_position % IMG_ALIGNMENT == 0;
+
+    valid = valid && header->hash_check == hash_fn(IMG_HASH_PROBE, IMG_HASH_PROBE + sizeof(IMG_HASH_PROBE));
+
+    const char* file = (const char*) map.ptr;
+    valid = valid && ((const uint64_t*) (file + header->offsets_position))[header->bucket_count] == header->size;
+
+    _LOG_FAIL_CHECK_(valid, "error", ERROR_REPORTS, {
+        munmap(map.ptr, map.size);
+        close(map.fd);
+        return;
+    }, err_code, EINVAL);
+
+    image->size = header->size;
+    image->bucket_count = header->bucket_count;
+    FastMod_ctor(&image->bucket_mod, header->bucket_count);
+
+    image->offsets = (const uint64_t*) (file + header->offsets_position);
+    image->tags = (const ht_tag_t*) (file + header->tags_position);
+    image->keys = (const img_elem_t*) (file + header->keys_position);
+    image->values = file + header->values_position;
+    image->data = file + header->data_position;
+    image->map = map;
+}
+
+void TableImage_close(TableImage* image) {
+    _LOG_FAIL_CHECK_(image, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    if (image->map.ptr) {
+        munmap(image->map.ptr, image->map.size);
+        close(image->map.fd);
+    }
+
+    *image = {};
+}
+
+img_status_t TableImage_status(const TableImage* image) {
+    if (!image) return IMG_NULL;
+    if (!image->map.ptr || !image->offsets) return IMG_NO_CONTENT;
+
+    return 0;
+}
+
+void TableImage_find_batch(const TableImage* image, const hash_t* hashes, const HT_ELEM_T* values, size_t count,
+                           const img_elem_t** results, ht_compar_fn_t* comparator) {
+    _LOG_FAIL_CHECK_(TableImage_status(image) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(count == 0 || (hashes && values && results), "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    //* Bucket offsets are requested first, tags and elements of the bucket once its offset has arrived.
+    for (size_t id = 0; id < count; ++id) {
+        if (id + IMG_BATCH_DISTANCE < count) {
+            size_t bucket_id = (size_t) FastMod_reduce(&image->bucket_mod, hashes[id + IMG_BATCH_DISTANCE]);
+            _mm_prefetch((const char*) &image->offsets[bucket_id], _MM_HINT_T0);
+        }
+
+        if (id + IMG_BATCH_DISTANCE / 2 < count) {
+            size_t bucket_id = (size_t) FastMod_reduce(&image->bucket_mod, hashes[id + IMG_BATCH_DISTANCE / 2]);
+            _mm_prefetch((const char*) &image->tags[image->offsets[bucket_id]], _MM_HINT_T0);
+            _mm_prefetch((const char*) &image->keys[image->offsets[bucket_id]], _MM_HINT_T0);
+        }
+
+        size_t bucket_id = (size_t) FastMod_reduce(&image->bucket_mod, hashes[id]);
+        results[id] = _TableImage_find_in_bucket(image, bucket_id, hashes[id], values[id], comparator);
+    }
+}
+
+#endif
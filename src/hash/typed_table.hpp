@@ -0,0 +1,488 @@
+/**
+ * @file typed_table.hpp
+ * @author Kudryashov Ilya (kudriashov.it@phystech.edu)
+ * @brief Open-addressing hash table template over the key type, its hash and its equality.
+ * @version 0.1
+ * @date 2023-04-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef TYPED_TABLE_HPP
+#define TYPED_TABLE_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "lib/util/dbg/debug.h"
+#include "src/utils/config.h"
+
+#include "table_elem.h"
+
+//* The table grows when its load factor exceeds TYPED_MAX_LOAD_NUM / TYPED_MAX_LOAD_DEN.
+static const size_t TYPED_MAX_LOAD_NUM = 7;
+static const size_t TYPED_MAX_LOAD_DEN = 8;
+
+//* The table shrinks when its load factor drops below 1 / TYPED_SHRINK_DIVISOR.
+static const size_t TYPED_SHRINK_DIVISOR = 8;
+
+//* Number of keys batched lookup prefetches at once.
+static const size_t TYPED_BATCH_GROUP = 16;
+
+//* Minimal number of slots of the table.
+static const size_t TYPED_MIN_CAPACITY = 16;
+
+//* Control byte of an empty slot, occupied slots have the top bit set and keep 7 bits of the hash below it.
+static const uint8_t TYPED_EMPTY = 0;
+
+typedef unsigned typed_status_t;
+
+enum TYPED_STATUS {
+    TYPED_NULL          = 1 << 0,
+    TYPED_NO_CONTENT    = 1 << 1,
+    TYPED_BAD_CAPACITY  = 1 << 2,
+    TYPED_BIG_SIZE      = 1 << 3,
+};
+
+/**
+ * @brief Key of at most MAX_WORD_LENGTH characters stored in place and padded with zeros.
+ *
+ * @param bytes characters of the key
+ */
+struct FixedKey {
+    __m256i bytes;
+};
+
+/**
+ * @brief Hash function of the key type (specialized for every supported key).
+ *
+ * @tparam Key
+ */
+template <typename Key> struct KeyHash;
+
+/**
+ * @brief Equality of the key type (specialized for every supported key).
+ *
+ * @tparam Key
+ */
+template <typename Key> struct KeyEqual;
+
+/**
+ * @brief Open-addressing hash table with linear probing and backward-shift erasure.
+ *
+ * Hashing and comparison are template parameters, so the compiler inlines them into the probe loop
+ * instead of calling them through function pointers. Keys are stored in their own type,
+ * so 8-byte keys take 8 bytes of the slot array and 32-byte keys are compared with a single AVX2 instruction.
+ * Each slot has a control byte with 7 bits of the hash, so most mismatching slots are skipped without touching the keys.
+ *
+ * @tparam Key type of the keys (should be trivially copyable)
+ * @tparam Hash functor mapping keys to hash_t
+ * @tparam Eq functor returning true on equal keys
+ *
+ * @param size number of stored elements
+ * @param min_capacity initial number of slots (the table never shrinks below it)
+ * @param capacity number of slots (power of two)
+ * @param control control byte of each slot
+ * @param keys key storage followed by the values of the keys
+ */
+template <typename Key, typename Hash = KeyHash<Key>, typename Eq = KeyEqual<Key>>
+struct TypedTable {
+    size_t size = 0;
+    size_t min_capacity = 0;
+    size_t capacity = 0;
+    uint8_t* control = NULL;
+    Key* keys = NULL;
+};
+
+typedef TypedTable<uint64_t> IntTable;
+typedef TypedTable<double> DoubleTable;
+typedef TypedTable<FixedKey> FixedTable;
+
+
+//* DECLARATIONS
+
+/**
+ * @brief Make fixed key out of the word
+ *
+ * @param data characters of the word
+ * @param length length of the word (should not exceed MAX_WORD_LENGTH)
+ * @return FixedKey
+ */
+static inline FixedKey fixed_key_make(const char* data, size_t length);
+
+/**
+ * @brief Construct typed table data structure
+ *
+ * @param table pointer to the table
+ * @param bucket_count initial number of slots (rounded up to a power of two)
+ * @param err_code pointer to the errno-functioning variable
+ */
+template <typename Key, typename Hash, typename Eq>
+void TypedTable_ctor(TypedTable<Key, Hash, Eq>* table, size_t bucket_count, ERROR_MARKER);
+
+/**
+ * @brief Destroy the table
+ *
+ * @param table pointer to the table to destroy
+ */
+template <typename Key, typename Hash, typename Eq>
+void TypedTable_dtor(TypedTable<Key, Hash, Eq>* table);
+
+/**
+ * @brief Get status of the table
+ *
+ * @param table pointer to the table
+ * @return typed_status_t
+ */
+template <typename Key, typename Hash, typename Eq>
+typed_status_t TypedTable_status(const TypedTable<Key, Hash, Eq>* table);
+
+/**
+ * @brief Insert a key
+ *
+ * @param table pointer to the table
+ * @param key
+ * @param err_code pointer to the errno-functioning variable
+ */
+template <typename Key, typename Hash, typename Eq>
+void TypedTable_insert(TypedTable<Key, Hash, Eq>* table, Key key, ERROR_MARKER);
+
+/**
+ * @brief Find a key or insert it if it is not in the table
+ *
+ * @param table pointer to the table
+ * @param key
+ * @param err_code pointer to the errno-functioning variable
+ * @return pointer to the value mapped to the key (zero-initialized for new keys, NULL on failure),
+ *         valid until the next insertion or erasure
+ */
+template <typename Key, typename Hash, typename Eq>
+ht_value_t* TypedTable_upsert(TypedTable<Key, Hash, Eq>* table, Key key, ERROR_MARKER);
+
+/**
+ * @brief Remove a key from the table
+ *
+ * @param table pointer to the table
+ * @param key
+ * @param err_code pointer to the errno-functioning variable
+ * @return true if the key was present in the table
+ */
+template <typename Key, typename Hash, typename Eq>
+bool TypedTable_erase(TypedTable<Key, Hash, Eq>* table, Key key, ERROR_MARKER);
+
+/**
+ * @brief Find key in the table
+ *
+ * @param table table to search in
+ * @param key
+ * @return pointer to the key slot in the table (NULL if the key was not found)
+ */
+template <typename Key, typename Hash, typename Eq>
+const Key* TypedTable_find_value(const TypedTable<Key, Hash, Eq>* table, Key key);
+
+/**
+ * @brief Find several keys in the table, prefetching their home slots ahead of time
+ *
+ * @param table table to search in
+ * @param keys keys to search for
+ * @param count number of keys
+ * @param results array the pointers to the found slots are written to (NULL for absent keys)
+ */
+template <typename Key, typename Hash, typename Eq>
+void TypedTable_find_batch(const TypedTable<Key, Hash, Eq>* table, const Key* keys, size_t count, const Key** results);
+
+/**
+ * @brief Get the value mapped to the key slot
+ *
+ * @param table
+ * @param slot slot returned by the lookup
+ * @return ht_value_t*
+ */
+template <typename Key, typename Hash, typename Eq>
+ht_value_t* TypedTable_value(const TypedTable<Key, Hash, Eq>* table, const Key* slot);
+
+
+//* IMPLEMENTATIONS ==============================
+
+//* Finalizer of MurmurHash3, every bit of the word affects every bit of the result.
+static inline hash_t _key_mix(uint64_t word) {
+    word ^= word >> 33;
+    word *= 0xFF51AFD7ED558CCDULL;
+    word ^= word >> 33;
+    word *= 0xC4CEB9FE1A85EC53ULL;
+    word ^= word >> 33;
+    return word;
+}
+
+template <> struct KeyHash<uint64_t> {
+    hash_t operator()(uint64_t key) const { return _key_mix(key); }
+};
+
+template <> struct KeyEqual<uint64_t> {
+    bool operator()(uint64_t alpha, uint64_t beta) const { return alpha == beta; }
+};
+
+//* Doubles are hashed and compared by their bits, with negative zero turned into positive zero, so equal numbers match.
+static inline uint64_t _key_double_bits(double key) {
+    uint64_t bits = 0;
+    memcpy(&bits, &key, sizeof(bits));
+    return bits << 1 == 0 ? 0 : bits;
+}
+
+template <> struct KeyHash<double> {
+    hash_t operator()(double key) const { return _key_mix(_key_double_bits(key)); }
+};
+
+template <> struct KeyEqual<double> {
+    bool operator()(double alpha, double beta) const { return _key_double_bits(alpha) == _key_double_bits(beta); }
+};
+
+template <> struct KeyHash<FixedKey> {
+    hash_t operator()(FixedKey key) const {
+        hash_t hash = 0;
+        hash = (hash ^ (uint64_t) _mm256_extract_epi64(key.bytes, 0)) * 0x9E3779B97F4A7C15ULL;
+        hash = (hash ^ (uint64_t) _mm256_extract_epi64(key.bytes, 1)) * 0x9E3779B97F4A7C15ULL;
+        hash = (hash ^ (uint64_t) _mm256_extract_epi64(key.bytes, 2)) * 0x9E3779B97F4A7C15ULL;
+        hash = (hash ^ (uint64_t) _mm256_extract_epi64(key.bytes, 3)) * 0x9E3779B97F4A7C15ULL;
+        return _key_mix(hash);
+    }
+};
+
+template <> struct KeyEqual<FixedKey> {
+    bool operator()(FixedKey alpha, FixedKey beta) const {
+        __m256i difference = _mm256_xor_si256(alpha.bytes, beta.bytes);
+        return _mm256_testz_si256(difference, difference);
+    }
+};
+
+static inline FixedKey fixed_key_make(const char* data, size_t length) {
+    char buffer[MAX_WORD_LENGTH] __attribute__((__aligned__(32))) = "";
+    memcpy(buffer, data, length < MAX_WORD_LENGTH ? length : MAX_WORD_LENGTH);
+    return {_mm256_load_si256((const __m256i*) buffer)};
+}
+
+static inline uint8_t _TypedTable_tag(hash_t hash) {
+    return (uint8_t) (hash >> 57 | 0x80);
+}
+
+template <typename Key, typename Hash, typename Eq>
+static inline void* _TypedTable_values(const TypedTable<Key, Hash, Eq>* table) {
+    return table->keys + table->capacity;
+}
+
+/**
+ * @brief Find the slot of the key or the empty slot that ends its probe sequence.
+ *
+ * @return true if the key was found
+ */
+template <typename Key, typename Hash, typename Eq>
+static inline bool _TypedTable_probe(const TypedTable<Key, Hash, Eq>* table, Key key, hash_t hash, size_t* slot_id) {
+    size_t mask = table->capacity - 1;
+    uint8_t tag = _TypedTable_tag(hash);
+
+    for (size_t probe_id = hash & mask; ; probe_id = (probe_id + 1) & mask) {
+        uint8_t control = table->control[probe_id];
+
+        if (control == TYPED_EMPTY || (control == tag && Eq()(table->keys[probe_id], key))) {
+            *slot_id = probe_id;
+            return control != TYPED_EMPTY;
+        }
+    }
+}
+
+template <typename Key, typename Hash, typename Eq>
+static void _TypedTable_allocate(TypedTable<Key, Hash, Eq>* table, size_t capacity, err_anchor_t err_code) {
+    table->control = (uint8_t*) calloc(capacity, sizeof(*table->control));
+    table->keys = NULL;
+
+    size_t alignment = alignof(Key) > sizeof(void*) ? alignof(Key) : sizeof(void*);
+    int key_status = posix_memalign((void**) &table->keys, alignment, capacity * (sizeof(*table->keys) + HT_VALUE_SIZE));
+
+    if (!table->control || key_status != 0) {
+        free(table->control);
+        if (key_status == 0) free(table->keys);
+        table->control = NULL;
+        table->keys = NULL;
+        if (err_code) *err_code = ENOMEM;
+        return;
+    }
+
+    table->capacity = capacity;
+    table->size = 0;
+}
+
+template <typename Key, typename Hash, typename Eq>
+static void _TypedTable_rehash(TypedTable<Key, Hash, Eq>* table, size_t new_capacity, err_anchor_t err_code) {
+    TypedTable<Key, Hash, Eq> old_table = *table;
+
+    _TypedTable_allocate(table, new_capacity, err_code);
+    if (!table->control) {
+        *table = old_table;
+        return;
+    }
+
+    void* old_values = _TypedTable_values(&old_table);
+    void* values = _TypedTable_values(table);
+
+    //* Keys are distinct, so every key goes straight to the first empty slot of its probe sequence.
+    for (size_t old_id = 0; old_id < old_table.capacity; ++old_id) {
+        if (old_table.control[old_id] == TYPED_EMPTY) continue;
+
+        size_t slot_id = 0;
+        _TypedTable_probe(table, old_table.keys[old_id], Hash()(old_table.keys[old_id]), &slot_id);
+
+        table->control[slot_id] = old_table.control[old_id];
+        table->keys[slot_id] = old_table.keys[old_id];
+        memcpy(value_at(values, slot_id), value_at(old_values, old_id), HT_VALUE_SIZE);
+    }
+
+    table->size = old_table.size;
+
+    free(old_table.control);
+    free(old_table.keys);
+}
+
+template <typename Key, typename Hash, typename Eq>
+void TypedTable_ctor(TypedTable<Key, Hash, Eq>* table, size_t bucket_count, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(table, "error", ERROR_REPORTS, return, err_code, EINVAL);
+
+    *table = {};
+
+    size_t capacity = TYPED_MIN_CAPACITY;
+    while (capacity < bucket_count) capacity *= 2;
+
+    _TypedTable_allocate(table, capacity, err_code);
+    table->min_capacity = table->capacity;
+}
+
+template <typename Key, typename Hash, typename Eq>
+void TypedTable_dtor(TypedTable<Key, Hash, Eq>* table) {
+    _LOG_FAIL_CHECK_(TypedTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    free(table->control);
+    free(table->keys);
+
+    *table = {};
+}
+
+template <typename Key, typename Hash, typename Eq>
+typed_status_t TypedTable_status(const TypedTable<Key, Hash, Eq>* table) {
+    if (!table) return TYPED_NULL;
+    if (!table->control || !table->keys) return TYPED_NO_CONTENT;
+
+    typed_status_t status = 0;
+
+    if (table->capacity < TYPED_MIN_CAPACITY || (table->capacity & (table->capacity - 1))) status |= TYPED_BAD_CAPACITY;
+    if (table->size >= table->capacity) status |= TYPED_BIG_SIZE;
+
+    return status;
+}
+
+template <typename Key, typename Hash, typename Eq>
+void TypedTable_insert(TypedTable<Key, Hash, Eq>* table, Key key, err_anchor_t err_code) {
+    TypedTable_upsert(table, key, err_code);
+}
+
+template <typename Key, typename Hash, typename Eq>
+ht_value_t* TypedTable_upsert(TypedTable<Key, Hash, Eq>* table, Key key, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(TypedTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, err_code, EINVAL);
+
+    hash_t hash = Hash()(key);
+
+    size_t slot_id = 0;
+    if (_TypedTable_probe(table, key, hash, &slot_id)) return value_at(_TypedTable_values(table), slot_id);
+
+    if ((table->size + 1) * TYPED_MAX_LOAD_DEN > table->capacity * TYPED_MAX_LOAD_NUM) {
+        _TypedTable_rehash(table, table->capacity * 2, err_code);
+
+        //* The table is only ever completely filled if it could not grow.
+        _LOG_FAIL_CHECK_(table->size + 1 < table->capacity, "error", ERROR_REPORTS, return NULL, err_code, ENOMEM);
+
+        _TypedTable_probe(table, key, hash, &slot_id);
+    }
+
+    table->control[slot_id] = _TypedTable_tag(hash);
+    table->keys[slot_id] = key;
+    memset(value_at(_TypedTable_values(table), slot_id), 0, HT_VALUE_SIZE);
+
+    ++table->size;
+
+    return value_at(_TypedTable_values(table), slot_id);
+}
+
+template <typename Key, typename Hash, typename Eq>
+bool TypedTable_erase(TypedTable<Key, Hash, Eq>* table, Key key, err_anchor_t err_code) {
+    _LOG_FAIL_CHECK_(TypedTable_status(table) == 0, "error", ERROR_REPORTS, return false, err_code, EINVAL);
+
+    size_t hole_id = 0;
+    if (!_TypedTable_probe(table, key, Hash()(key), &hole_id)) return false;
+
+    void* values = _TypedTable_values(table);
+    size_t mask = table->capacity - 1;
+
+    //* Every key after the hole moves into it unless its home slot lies between the hole and the key,
+    //* so probe sequences stay unbroken without tombstones.
+    for (size_t next_id = (hole_id + 1) & mask; table->control[next_id] != TYPED_EMPTY; next_id = (next_id + 1) & mask) {
+        size_t home_id = Hash()(table->keys[next_id]) & mask;
+        if (((next_id - home_id) & mask) < ((next_id - hole_id) & mask)) continue;
+
+        table->control[hole_id] = table->control[next_id];
+        table->keys[hole_id] = table->keys[next_id];
+        memcpy(value_at(values, hole_id), value_at(values, next_id), HT_VALUE_SIZE);
+
+        hole_id = next_id;
+    }
+
+    table->control[hole_id] = TYPED_EMPTY;
+    --table->size;
+
+    if (table->capacity > table->min_capacity && table->size * TYPED_SHRINK_DIVISOR < table->capacity) {
+        _TypedTable_rehash(table, table->capacity / 2, err_code);
+    }
+
+    return true;
+}
+
+template <typename Key, typename Hash, typename Eq>
+const Key* TypedTable_find_value(const TypedTable<Key, Hash, Eq>* table, Key key) {
+    _LOG_FAIL_CHECK_(TypedTable_status(table) == 0, "error", ERROR_REPORTS, return NULL, NULL, EINVAL);
+
+    size_t slot_id = 0;
+    return _TypedTable_probe(table, key, Hash()(key), &slot_id) ? table->keys + slot_id : NULL;
+}
+
+template <typename Key, typename Hash, typename Eq>
+void TypedTable_find_batch(const TypedTable<Key, Hash, Eq>* table, const Key* keys, size_t count, const Key** results) {
+    _LOG_FAIL_CHECK_(TypedTable_status(table) == 0, "error", ERROR_REPORTS, return, NULL, EINVAL);
+    _LOG_FAIL_CHECK_(keys && results, "error", ERROR_REPORTS, return, NULL, EINVAL);
+
+    size_t mask = table->capacity - 1;
+    hash_t hashes[TYPED_BATCH_GROUP] = {};
+
+    for (size_t group_start = 0; group_start < count; group_start += TYPED_BATCH_GROUP) {
+        size_t group_size = count - group_start < TYPED_BATCH_GROUP ? count - group_start : TYPED_BATCH_GROUP;
+
+        //* Hashes of the whole group are computed first, so the home slots are already on their way when probing starts.
+        for (size_t key_id = 0; key_id < group_size; ++key_id) {
+            hashes[key_id] = Hash()(keys[group_start + key_id]);
+            _mm_prefetch((const char*) &table->control[hashes[key_id] & mask], _MM_HINT_T0);
+            _mm_prefetch((const char*) &table->keys[hashes[key_id] & mask], _MM_HINT_T0);
+        }
+
+        for (size_t key_id = 0; key_id < group_size; ++key_id) {
+            size_t slot_id = 0;
+            bool found = _TypedTable_probe(table, keys[group_start + key_id], hashes[key_id], &slot_id);
+            results[group_start + key_id] = found ? table->keys + slot_id : NULL;
+        }
+    }
+}
+
+template <typename Key, typename Hash, typename Eq>
+ht_value_t* TypedTable_value(const TypedTable<Key, Hash, Eq>* table, const Key* slot) {
+    return value_at(_TypedTable_values(table), (size_t) (slot - table->keys));
+}
+
+#endif
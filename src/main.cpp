@@ -17,6 +17,7 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <time.h>
 #include <x86intrin.h>
 
 #include "lib/util/dbg/debug.h"
@@ -28,12 +29,391 @@
 #include "utils/main_utils.h"
 
 #include "hash/hash_functions.h"
+#include "hash/elem_batch.hpp"
 #include "hash/hash_table.hpp"
+#include "hash/swiss_table.hpp"
+#include "hash/cuckoo_table.hpp"
+#include "hash/robin_table.hpp"
+#include "hash/concurrent_table.hpp"
+#include "hash/atomic_table.hpp"
+#include "hash/sharded_table.hpp"
+#include "hash/frozen_table.hpp"
+#include "hash/table_image.hpp"
+#include "hash/typed_table.hpp"
+#include "hash/hash_quality.hpp"
 
 #define MAIN
 
-#if OPTIMIZATION_LEVEL >= 1
-int simd_comparison_placeholder(__m256i alpha, __m256i beta) { return 0; }
+//* Call function of the tested table engine (TABLE_FN(insert) -> HashTable_insert).
+#define TABLE_FN(name) _TABLE_FN_IMPL(TESTED_TABLE, name)
+#define _TABLE_FN_IMPL(table, name) __TABLE_FN_IMPL(table, name)
+#define __TABLE_FN_IMPL(table, name) table##_##name
+
+//* Hash of the element the tested table expects (SEEDED_HASH tables hash under their own secret seed).
+#ifdef SEEDED_HASH
+#define TABLE_HASH(table, hash_fn, elem) HashTable_hash(table, *(elem))
+#else
+#define TABLE_HASH(table, hash_fn, elem) hash_elem(hash_fn, elem)
+#endif
+
+#if defined(SEEDED_HASH) && (defined(LOOKUP_FROZEN) || defined(LOOKUP_IMAGE))
+#error "Frozen tables and table images are searched with unseeded hashes, they can not be tested with SEEDED_HASH."
+#endif
+
+#ifdef CONCURRENT_TEST
+/**
+ * @brief Lookups performed by a single reader thread.
+ *
+ * @param table tested table
+ * @param hashes hashes of the requests
+ * @param requests elements to look up
+ * @param count number of requests
+ * @param first request the reader starts from (requests are looked up in cyclic order)
+ * @param comparator comparator function between elements
+ * @param found number of requests that were found in the table
+ */
+struct ReaderTask {
+    TESTED_TABLE* table;
+    const hash_t* hashes;
+    const HT_ELEM_T* requests;
+    size_t count;
+    size_t first;
+    ht_compar_fn_t* comparator;
+    size_t found;
+};
+
+/**
+ * @brief Insertions performed by the writer thread while readers are running.
+ *
+ * @param table tested table
+ * @param hash_fn hash function of the table
+ * @param word_list words to insert (the writer continues from where it has stopped during the previous run)
+ * @param list_size size of the word list
+ * @param comparator comparator function between elements
+ * @param stop flag telling the writer to stop
+ * @param offset offset of the next word in the list
+ * @param erasing whether the current pass over the list erases the words instead of inserting them
+ * @param written number of words inserted or erased so far
+ */
+struct WriterTask {
+    TESTED_TABLE* table;
+    hash_fn_t* hash_fn;
+    const char* word_list;
+    size_t list_size;
+    ht_compar_fn_t* comparator;
+    bool stop;
+    size_t offset;
+    bool erasing;
+    size_t written;
+};
+
+static void* reader_routine(void* arg) {
+    ReaderTask* task = (ReaderTask*) arg;
+
+    for (size_t step = 0; step < task->count; ++step) {
+        size_t request_id = (task->first + step) % task->count;
+        task->found += TABLE_FN(find_value)(task->table, task->hashes[request_id], task->requests[request_id],
+                                            task->comparator) != NULL;
+    }
+
+    return NULL;
+}
+
+static void* writer_routine(void* arg) {
+    WriterTask* task = (WriterTask*) arg;
+
+    //* The writer alternates insertion and erasure passes over the list, so it keeps writing for the whole measurement.
+    while (!__atomic_load_n(&task->stop, __ATOMIC_RELAXED)) {
+        if (task->offset >= task->list_size) {
+            task->offset = 0;
+            task->erasing = !task->erasing;
+        }
+
+        const char* word = task->word_list + task->offset;
+        size_t space = task->list_size - task->offset;
+
+        HT_ELEM_T key = elem_make(word, word_key_length(word, space));
+        if (task->erasing) TABLE_FN(erase)(task->table, hash_elem(task->hash_fn, &key), key, task->comparator);
+        else TABLE_FN(insert)(task->table, hash_elem(task->hash_fn, &key), key, task->comparator);
+
+        task->offset += word_record_size(word, space);
+        ++task->written;
+    }
+
+    return NULL;
+}
+#endif
+
+#ifdef LOOKUP_TYPED
+//* Typed table the keys of the generated sample are looked up in (integers and doubles take their own layout).
+#if defined(GEN_INT)
+typedef uint64_t typed_key_t;
+#elif defined(GEN_DOUBLE)
+typedef double typed_key_t;
+#else
+typedef FixedKey typed_key_t;
+#endif
+
+typedef TypedTable<typed_key_t> typed_table_t;
+
+/**
+ * @brief Make key of the typed table out of the sample record.
+ *
+ * @param record record of the word list
+ * @param space number of bytes left in the word list
+ * @return typed_key_t
+ */
+static typed_key_t typed_key_make(const char* record, size_t space) {
+    #if defined(GEN_INT)
+    SILENCE_UNUSED(space);
+    return *(const unsigned*) record;
+    #elif defined(GEN_DOUBLE)
+    SILENCE_UNUSED(space);
+    return *(const double*) record;
+    #else
+    return fixed_key_make(record, strnlen(record, space));
+    #endif
+}
+
+static void typed_table_dtor(typed_table_t* table) {
+    TypedTable_dtor(table);
+}
+#endif
+
+#if defined(BUILD_TEST) && !defined(BULK_BUILD)
+/**
+ * @brief Insertions performed by a single thread building the table.
+ *
+ * @param table table under construction
+ * @param hashes hashes of the elements
+ * @param elements elements to insert
+ * @param count number of elements
+ * @param first index of the first element the thread inserts (the thread inserts every element, wrapping around the end)
+ * @param comparator comparator function between elements
+ */
+struct BuilderTask {
+    TESTED_TABLE* table;
+    const hash_t* hashes;
+    const HT_ELEM_T* elements;
+    size_t count;
+    size_t first;
+    ht_compar_fn_t* comparator;
+};
+
+static void* builder_routine(void* arg) {
+    BuilderTask* task = (BuilderTask*) arg;
+
+    for (size_t step = 0; step < task->count; ++step) {
+        size_t elem_id = (task->first + step) % task->count;
+        TABLE_FN(insert)(task->table, task->hashes[elem_id], task->elements[elem_id], task->comparator);
+    }
+
+    return NULL;
+}
+#endif
+
+//* Kind of keys the sample generator produces, -Fall tests only the hash functions meant for them.
+#if defined(GEN_INT)
+static const unsigned GENERATED_KEY_TYPE = HASH_KEY_INT;
+#elif defined(GEN_DOUBLE)
+static const unsigned GENERATED_KEY_TYPE = HASH_KEY_DOUBLE;
+#else
+static const unsigned GENERATED_KEY_TYPE = HASH_KEY_STRING;
+#endif
+
+/**
+ * @brief Select hash functions to test
+ *
+ * @param name name of the function, "all" for every function suitable for the generated keys or empty string for TESTED_HASH
+ * @param selection array of HASH_FUNCTION_COUNT elements to write the selected functions to
+ * @return number of selected functions (0 if there is no function with the name)
+ */
+static size_t select_hash_functions(const char* name, const HashFunctionInfo** selection) {
+    if (*name == '\0') {
+        selection[0] = find_hash_function(TESTED_HASH);
+        return selection[0] != NULL;
+    }
+
+    if (strcmp(name, "all") != 0) {
+        selection[0] = find_hash_function(name);
+        return selection[0] != NULL;
+    }
+
+    size_t count = 0;
+    for (size_t hash_id = 0; hash_id < HASH_FUNCTION_COUNT; ++hash_id) {
+        if (HASH_FUNCTIONS[hash_id].key_types & GENERATED_KEY_TYPE) selection[count++] = &HASH_FUNCTIONS[hash_id];
+    }
+
+    return count;
+}
+
+#if defined(DISTRIBUTION_TEST) || defined(PERFORMANCE_TEST)
+/**
+ * @brief Replace the table with an empty one hashed with another function
+ *
+ * @param table tested table
+ * @param bucket_count initial number of buckets
+ * @param hash_fn new hash function
+ */
+static void reset_table(TESTED_TABLE* table, size_t bucket_count, hash_fn_t* hash_fn) {
+    TABLE_FN(dtor)(table);
+    TABLE_FN(ctor)(table, bucket_count, hash_fn, &errno);
+
+    #ifdef SEEDED_HASH
+    HashTable_seed(table, sip_hash, &errno);
+    #endif
+
+    #ifdef BLOOM_FILTER
+    HashTable_reserve_filter(table, FILTER_EXPECTED_COUNT, &errno);
+    #endif
+}
+#endif
+
+#ifdef PROBE_LENGTH
+/**
+ * @brief Write the mean and the variance of the probe length of the table elements
+ *
+ * @param out_probe output file
+ * @param hash_name name of the hash function the table is filled with
+ * @param table tested table
+ */
+static void write_probe_lengths(FILE* out_probe, const char* hash_name, const TESTED_TABLE* table) {
+    size_t slot_count = TABLE_FN(bucket_count)(table);
+    size_t elem_count = 0;
+    double sum = 0, square_sum = 0;
+
+    for (size_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+        size_t probe_length = TABLE_FN(probe_length)(table, slot_id);
+        if (probe_length == 0) continue;
+
+        ++elem_count;
+        sum += (double) probe_length;
+        square_sum += (double) probe_length * (double) probe_length;
+    }
+
+    double mean = elem_count ? sum / (double) elem_count : 0;
+    double variance = elem_count ? square_sum / (double) elem_count - mean * mean : 0;
+    fprintf(out_probe, "%s,%lf,%lf\n", hash_name, mean, variance);
+}
+#endif
+
+#if defined(DISTRIBUTION_TEST) || defined(LOOKUP_TEST) || defined(CONCURRENT_TEST)
+/**
+ * @brief Insert every word of the word list into the table
+ *
+ * @param table tested table
+ * @param hash_fn hash function of the table
+ * @param word_list
+ * @param list_size size of the word list
+ * @param comparator comparator function between elements
+ */
+static void fill_table(TESTED_TABLE* table, hash_fn_t* hash_fn, const char* word_list, size_t list_size,
+                       ht_compar_fn_t* comparator) {
+    for (size_t offset = 0; offset < list_size; offset += word_record_size(word_list + offset, list_size - offset)) {
+        const char* word_ptr = word_list + offset;
+
+        HT_ELEM_T key = elem_make(word_ptr, word_key_length(word_ptr, list_size - offset));
+
+        TABLE_FN(insert)(table, TABLE_HASH(table, hash_fn, &key), key, comparator);
+    }
+}
+#endif
+
+#ifdef LOOKUP_TEST
+/**
+ * @brief Hash the requests with the seeded function
+ *
+ * @param requests
+ * @param count number of requests
+ * @param seed
+ * @param hashes array to write the hashes to
+ * @return time the hashing took
+ */
+static long time_seeded_hashing(const HT_ELEM_T* requests, size_t count, const HashSeed* seed, hash_t* hashes) {
+    clock_t start_time = clock();
+
+    for (size_t request_id = 0; request_id < count; ++request_id) {
+        hashes[request_id] = hash_elem_seeded(sip_hash, seed, &requests[request_id]);
+    }
+
+    return clock() - start_time;
+}
+#endif
+
+#ifdef PERFORMANCE_TEST
+/**
+ * @brief Time random lookups and insertions into the table for every test size
+ *
+ * @tparam hash_fn hash function of the table (a template parameter, so the loop calls it directly)
+ * @param table tested table
+ * @param comparator comparator function between elements
+ * @param times array of MAX_TEST_COUNT - MIN_TEST_COUNT elements to write the times to
+ */
+template <hash_fn_t* hash_fn>
+static void performance_test(TESTED_TABLE* table, ht_compar_fn_t* comparator, long* times) {
+    for (unsigned test_size = MIN_TEST_COUNT; test_size < MAX_TEST_COUNT; ++test_size) {
+        clock_t start_time = clock();
+
+        for (size_t action_id = 0; action_id < test_size; ++action_id) {
+            static char word[MAX_WORD_LENGTH] __attribute__((__aligned__(32))) = "";
+            for (char* ptr = word; ptr < word + MAX_WORD_LENGTH; ++ptr) {
+                *ptr = (char) rand();
+            }
+            //* Terminated word is a valid short key as it is.
+            word[MAX_WORD_LENGTH - 1] = '\0';
+
+            unsigned op_key = rand() % 100;
+
+            #if OPTIMIZATION_LEVEL < 1
+            HT_ELEM_T elem = word;
+            #else
+            HT_ELEM_T elem = _mm256_load_si256((const __m256i*) word);
+            #endif
+
+            #ifdef SEEDED_HASH
+            hash_t hash = HashTable_hash(table, elem);
+            #else
+            hash_t hash = hash_fn(word, word + MAX_WORD_LENGTH);
+            #endif
+
+            if (op_key < 50) {
+                TABLE_FN(find_value)(table, hash, elem, comparator);
+            } else {
+                TABLE_FN(insert)(table, hash, elem, comparator);
+            }
+        }
+
+        times[test_size - MIN_TEST_COUNT] = clock() - start_time;
+    }
+}
+
+/**
+ * @brief Run performance_test instantiated with the registered hash function
+ */
+static void run_performance_test(const HashFunctionInfo* hash, TESTED_TABLE* table, ht_compar_fn_t* comparator, long* times) {
+    #define _PERFORMANCE_TEST_ENTRY(hash_fn, batch, key_types) \
+        if (hash->function == hash_fn) return performance_test<hash_fn>(table, comparator, times);
+
+    HASH_FUNCTION_LIST(_PERFORMANCE_TEST_ENTRY)
+
+    #undef _PERFORMANCE_TEST_ENTRY
+}
+#endif
+
+#ifdef QUALITY_TEST
+/**
+ * @brief Run the quality suite and measure speed of the registered hash function
+ */
+static void run_quality_test(const HashFunctionInfo* hash, HashQualityReport* report) {
+    HashQuality_test(report, hash->function, &errno);
+
+    #define _QUALITY_TEST_ENTRY(hash_fn, batch, key_types) \
+        if (hash->function == hash_fn) return HashQuality_measure_speed<hash_fn>(report, &errno);
+
+    HASH_FUNCTION_LIST(_QUALITY_TEST_ENTRY)
+
+    #undef _QUALITY_TEST_ENTRY
+}
 #endif
 
 int main(const int argc, const char** argv) {
@@ -43,6 +423,12 @@ int main(const int argc, const char** argv) {
     unsigned int log_threshold = STATUS_REPORTS;
     MAKE_WRAPPER(log_threshold);
 
+    int bucket_count = BUCKET_COUNT;
+    MAKE_WRAPPER(bucket_count);
+
+    char hash_name[MAX_HASH_NAME_LENGTH] = "";
+    MAKE_WRAPPER(hash_name);
+
     ActionTag line_tags[] = {
         #include "cmd_flags/main_flags.h"
     };
@@ -52,17 +438,46 @@ int main(const int argc, const char** argv) {
     log_init("program_log.html", log_threshold, &errno);
     print_label();
 
+    const HashFunctionInfo* tested_hashes[HASH_FUNCTION_COUNT] = {};
+    size_t tested_hash_count = select_hash_functions(hash_name, tested_hashes);
+    _LOG_FAIL_CHECK_(tested_hash_count > 0, "error", ERROR_REPORTS, {
+        log_printf(ERROR_REPORTS, "error", "There is no hash function named \"%s\".\n", hash_name);
+        return_clean(EXIT_FAILURE);
+    }, NULL, EINVAL);
+
+    hash_fn_t* tested_hash = tested_hashes[0]->function;
+    log_printf(STATUS_REPORTS, "status", "Testing %lu hash function(s) starting with %s.\n",
+               tested_hash_count, tested_hashes[0]->name);
+
     log_printf(STATUS_REPORTS, "status", "Initializing the table.\n");
+    _LOG_FAIL_CHECK_(bucket_count > 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, EINVAL);
 
-    HashTable table = {};
-    HashTable_ctor(&table, &errno);
-    _LOG_FAIL_CHECK_(HashTable_status(&table) == 0, "error", ERROR_REPORTS, {
-        log_printf(ERROR_REPORTS, "error", "Table status was %u;\n", HashTable_status(&table));
+    TESTED_TABLE table = {};
+    TABLE_FN(ctor)(&table, (size_t) bucket_count, tested_hash, &errno);
+    _LOG_FAIL_CHECK_(TABLE_FN(status)(&table) == 0, "error", ERROR_REPORTS, {
+        log_printf(ERROR_REPORTS, "error", "Table status was %u;\n", TABLE_FN(status)(&table));
         return_clean(EXIT_FAILURE);
     }, NULL, ENOMEM);
-    track_allocation(table, HashTable_dtor);
+    track_allocation(table, TABLE_FN(dtor));
 
-    #ifdef DISTRIBUTION_TEST  //* DISTRIBUTION TEST CASE ==============================
+    //* Elements are compared with the widest instructions the processor supports.
+    ht_compar_fn_t* comparator = elem_comparator();
+
+    #if OPTIMIZATION_LEVEL >= 1
+    log_printf(STATUS_REPORTS, "status", "Comparing elements with %s.\n", comparator == elem_compare_avx512 ? "AVX-512" : "AVX2");
+    #endif
+
+    #ifdef SEEDED_HASH
+    log_printf(STATUS_REPORTS, "status", "Seeding the table hash.\n");
+    HashTable_seed(&table, sip_hash, &errno);
+    #endif
+
+    #ifdef BLOOM_FILTER
+    log_printf(STATUS_REPORTS, "status", "Attaching lookup filter to the table.\n");
+    HashTable_reserve_filter(&table, FILTER_EXPECTED_COUNT, &errno);
+    #endif
+
+    #if defined(DISTRIBUTION_TEST) || defined(LOOKUP_TEST) || defined(CONCURRENT_TEST) || defined(BUILD_TEST)  //* SAMPLE GENERATION ==============================
 
     log_printf(STATUS_REPORTS, "status", "Generating input sample.\n");
     const char* word_list = NULL;
@@ -72,80 +487,516 @@ int main(const int argc, const char** argv) {
     generate_data((void*)word_list, (void*)(word_list + TEST_COUNT * MAX_WORD_LENGTH));
     track_allocation(word_list, free_variable);
 
-    log_printf(STATUS_REPORTS, "status", "Filling table with keys.\n");
+    size_t list_size = sample_size * MAX_WORD_LENGTH;
 
-    for (const char* word_ptr = word_list;
-        word_ptr < word_list + sample_size * MAX_WORD_LENGTH;
-        word_ptr += MAX_WORD_LENGTH) {
+    #endif
 
-        #if OPTIMIZATION_LEVEL < 1
-        HashTable_insert(&table, TESTED_HASH(word_ptr, word_ptr + MAX_WORD_LENGTH), word_ptr, strcmp);
-        #else
-        HashTable_insert(&table, TESTED_HASH(word_ptr, word_ptr + MAX_WORD_LENGTH),
-            _mm256_load_si256((const __m256i*) word_ptr), simd_comparison_placeholder);
-        #endif
-    }
+
+    #if defined(DISTRIBUTION_TEST) || defined(LOOKUP_TEST) || defined(CONCURRENT_TEST)  //* SAMPLE FILLING ==============================
+
+    log_printf(STATUS_REPORTS, "status", "Filling table with keys.\n");
+
+    fill_table(&table, tested_hash, word_list, list_size, comparator);
 
     log_printf(STATUS_REPORTS, "status", "The table is ready for testing.\n");
 
+    #endif
+
+
+    #ifdef DISTRIBUTION_TEST  //* DISTRIBUTION TEST CASE ==============================
 
     log_printf(STATUS_REPORTS, "status", "Opening distribution output file.\n");
 
     FILE* out_table = fopen(OUTPUT_TABLE_NAME, "w");
     _LOG_FAIL_CHECK_(out_table, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOENT);
 
+    #ifdef PROBE_LENGTH
+    FILE* out_probe = fopen(OUTPUT_PROBE_NAME, "w");
+    _LOG_FAIL_CHECK_(out_probe, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOENT);
+
+    fprintf(out_probe, "hash,mean,variance\n");
+    #endif
+
     log_printf(STATUS_REPORTS, "status", "Reading distribution data.\n");
-    fprintf(out_table, "bucket_id,size\n");
 
-    for (unsigned bucket_id = 0; bucket_id < BUCKET_COUNT; ++bucket_id) {
-        fprintf(out_table, "%u,%lu\n", bucket_id, table.contents[bucket_id].size);
+    //* Several functions get a column each, the table is refilled with the same keys for every one of them.
+    size_t* bucket_sizes = NULL;
+    track_allocation(bucket_sizes, free_variable);
+
+    size_t bucket_counts[HASH_FUNCTION_COUNT] = {};
+    size_t column_offsets[HASH_FUNCTION_COUNT] = {};
+    size_t row_count = 0, total_count = 0;
+
+    for (size_t hash_id = 0; hash_id < tested_hash_count; ++hash_id) {
+        if (hash_id > 0) {
+            reset_table(&table, (size_t) bucket_count, tested_hashes[hash_id]->function);
+            _LOG_FAIL_CHECK_(TABLE_FN(status)(&table) == 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+            fill_table(&table, tested_hashes[hash_id]->function, word_list, list_size, comparator);
+        }
+
+        bucket_counts[hash_id] = TABLE_FN(bucket_count)(&table);
+        column_offsets[hash_id] = total_count;
+        total_count += bucket_counts[hash_id];
+        if (bucket_counts[hash_id] > row_count) row_count = bucket_counts[hash_id];
+
+        size_t* new_sizes = (size_t*) realloc(bucket_sizes, (total_count + 1) * sizeof(*bucket_sizes));
+        _LOG_FAIL_CHECK_(new_sizes, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+        bucket_sizes = new_sizes;
+
+        for (size_t bucket_id = 0; bucket_id < bucket_counts[hash_id]; ++bucket_id) {
+            bucket_sizes[column_offsets[hash_id] + bucket_id] = TABLE_FN(bucket_size)(&table, bucket_id);
+        }
+
+        #ifdef PROBE_LENGTH
+        write_probe_lengths(out_probe, tested_hashes[hash_id]->name, &table);
+        #endif
+    }
+
+    if (tested_hash_count == 1) {
+        fprintf(out_table, "bucket_id,size\n");
+    } else {
+        fprintf(out_table, "bucket_id");
+        for (size_t hash_id = 0; hash_id < tested_hash_count; ++hash_id) fprintf(out_table, ",%s", tested_hashes[hash_id]->name);
+        fprintf(out_table, "\n");
+    }
+
+    for (size_t bucket_id = 0; bucket_id < row_count; ++bucket_id) {
+        fprintf(out_table, "%lu", bucket_id);
+        for (size_t hash_id = 0; hash_id < tested_hash_count; ++hash_id) {
+            if (bucket_id < bucket_counts[hash_id]) fprintf(out_table, ",%lu", bucket_sizes[column_offsets[hash_id] + bucket_id]);
+            else fprintf(out_table, ",");
+        }
+        fprintf(out_table, "\n");
     }
 
     if (out_table) fclose(out_table);
 
+    #ifdef PROBE_LENGTH
+    if (out_probe) fclose(out_probe);
+    #endif
+
     #endif
 
 
-    #ifdef PERFORMANCE_TEST  //* PERFORMANCE TEST CASE ==============================
+    #if defined(LOOKUP_TEST) || defined(CONCURRENT_TEST) || defined(BUILD_TEST)  //* REQUEST PREPARATION ==============================
+    log_printf(STATUS_REPORTS, "status", "Preparing lookup requests.\n");
+
+    HT_ELEM_T* requests = NULL;
+    alloc_status = posix_memalign((void**)&requests, 32, sample_size * sizeof(*requests));
+    _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+    track_allocation(requests, free_variable);
+
+    size_t request_count = 0;
+    for (size_t offset = 0; offset < list_size; offset += word_record_size(word_list + offset, list_size - offset)) {
+        requests[request_count++] = elem_make(word_list + offset, word_key_length(word_list + offset, list_size - offset));
+    }
+
+    //* Requests are shuffled, so buckets are accessed in an order hardware prefetcher can not predict.
+    for (size_t request_id = request_count - 1; request_id > 0; --request_id) {
+        size_t other_id = (size_t) rand() % (request_id + 1);
+        HT_ELEM_T request = requests[request_id];
+        requests[request_id] = requests[other_id];
+        requests[other_id] = request;
+    }
+
+    hash_t* request_hashes = (hash_t*) calloc(request_count, sizeof(*request_hashes));
+    track_allocation(request_hashes, free_variable);
+    _LOG_FAIL_CHECK_(request_hashes, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+
+    #ifdef SEEDED_HASH
+    for (size_t request_id = 0; request_id < request_count; ++request_id) {
+        request_hashes[request_id] = HashTable_hash(&table, requests[request_id]);
+    }
+    #else
+    hash_elem_batch(tested_hashes[0], requests, request_count, request_hashes);
+    #endif
+
+    #endif
+
+
+    #ifdef LOOKUP_TEST  //* LOOKUP TEST CASE ==============================
+    HT_ELEM_T** results = (HT_ELEM_T**) calloc(request_count, sizeof(*results));
+    track_allocation(results, free_variable);
+    _LOG_FAIL_CHECK_(results, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+
     log_printf(STATUS_REPORTS, "status", "Opening benchmark output file.\n");
 
     FILE* out_timetable = fopen(OUTPUT_TIMETABLE_NAME, "w");
     _LOG_FAIL_CHECK_(out_timetable, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOENT);
 
-    log_printf(STATUS_REPORTS, "status", "Writing header to the file.\n");
+    fprintf(out_timetable, "method,time\n");
+
+    log_printf(STATUS_REPORTS, "status", "Hashing the keys.\n");
+
+    //* Seeded hashing is timed next to the tested function, lookups then use the hashes the table expects.
+    #ifndef SEEDED_HASH
+    HashSeed request_seed = {};
+    hash_seed_draw(&request_seed, &errno);
+    fprintf(out_timetable, "hash_seeded,%ld\n", time_seeded_hashing(requests, request_count, &request_seed, request_hashes));
+    #endif
+
+    clock_t start_time = clock();
+    for (size_t request_id = 0; request_id < request_count; ++request_id) {
+        request_hashes[request_id] = hash_elem(tested_hash, &requests[request_id]);
+    }
+    fprintf(out_timetable, "hash,%ld\n", clock() - start_time);
+
+    start_time = clock();
+    hash_elem_batch(tested_hashes[0], requests, request_count, request_hashes);
+    fprintf(out_timetable, "hash_batch,%ld\n", clock() - start_time);
+
+    #ifdef SEEDED_HASH
+    fprintf(out_timetable, "hash_seeded,%ld\n", time_seeded_hashing(requests, request_count, &table.seed, request_hashes));
+    #endif
+
+    log_printf(STATUS_REPORTS, "status", "Looking the keys up one at a time.\n");
+
+    start_time = clock();
+    for (size_t request_id = 0; request_id < request_count; ++request_id) {
+        results[request_id] = TABLE_FN(find_value)(&table, request_hashes[request_id], requests[request_id], comparator);
+    }
+    fprintf(out_timetable, "single,%ld\n", clock() - start_time);
+
+    log_printf(STATUS_REPORTS, "status", "Looking the keys up in batches.\n");
+
+    start_time = clock();
+    for (size_t request_id = 0; request_id < request_count; request_id += LOOKUP_BATCH_SIZE) {
+        size_t batch_size = request_count - request_id < LOOKUP_BATCH_SIZE ? request_count - request_id : LOOKUP_BATCH_SIZE;
+        TABLE_FN(find_batch)(&table, request_hashes + request_id, requests + request_id, batch_size,
+                             results + request_id, comparator);
+    }
+    fprintf(out_timetable, "batch,%ld\n", clock() - start_time);
+
+    #ifdef LOOKUP_FROZEN
+
+    log_printf(STATUS_REPORTS, "status", "Freezing the table.\n");
+
+    FrozenTable frozen = {};
+    HashTable_freeze(&table, &frozen, &errno);
+    _LOG_FAIL_CHECK_(FrozenTable_status(&frozen) == 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+    track_allocation(frozen, FrozenTable_dtor);
+
+    log_printf(STATUS_REPORTS, "status", "Source table takes %lu bytes, frozen table takes %lu bytes.\n",
+               HashTable_footprint(&table), FrozenTable_footprint(&frozen));
+
+    log_printf(STATUS_REPORTS, "status", "Looking the keys up in the frozen table.\n");
+
+    start_time = clock();
+    for (size_t request_id = 0; request_id < request_count; ++request_id) {
+        results[request_id] = (HT_ELEM_T*) FrozenTable_find_value(&frozen, request_hashes[request_id], requests[request_id], comparator);
+    }
+    fprintf(out_timetable, "frozen,%ld\n", clock() - start_time);
+
+    start_time = clock();
+    for (size_t request_id = 0; request_id < request_count; request_id += LOOKUP_BATCH_SIZE) {
+        size_t batch_size = request_count - request_id < LOOKUP_BATCH_SIZE ? request_count - request_id : LOOKUP_BATCH_SIZE;
+        FrozenTable_find_batch(&frozen, request_hashes + request_id, requests + request_id, batch_size,
+                               (const HT_ELEM_T**) results + request_id, comparator);
+    }
+    fprintf(out_timetable, "frozen_batch,%ld\n", clock() - start_time);
+
+    #endif
+
+    #ifdef LOOKUP_IMAGE
+
+    log_printf(STATUS_REPORTS, "status", "Saving the table image.\n");
+
+    start_time = clock();
+    HashTable_save(&table, OUTPUT_IMAGE_NAME, &errno);
+    fprintf(out_timetable, "image_save,%ld\n", clock() - start_time);
+
+    TableImage image = {};
+
+    start_time = clock();
+    TableImage_open(&image, OUTPUT_IMAGE_NAME, tested_hash, &errno);
+    fprintf(out_timetable, "image_open,%ld\n", clock() - start_time);
+
+    _LOG_FAIL_CHECK_(TableImage_status(&image) == 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOENT);
+    track_allocation(image, TableImage_close);
+
+    log_printf(STATUS_REPORTS, "status", "Looking the keys up in the mapped image.\n");
+
+    start_time = clock();
+    for (size_t request_id = 0; request_id < request_count; ++request_id) {
+        results[request_id] = (HT_ELEM_T*) TableImage_find_value(&image, request_hashes[request_id], requests[request_id], comparator);
+    }
+    fprintf(out_timetable, "image,%ld\n", clock() - start_time);
+
+    start_time = clock();
+    for (size_t request_id = 0; request_id < request_count; request_id += LOOKUP_BATCH_SIZE) {
+        size_t batch_size = request_count - request_id < LOOKUP_BATCH_SIZE ? request_count - request_id : LOOKUP_BATCH_SIZE;
+        TableImage_find_batch(&image, request_hashes + request_id, requests + request_id, batch_size,
+                              (const img_elem_t**) results + request_id, comparator);
+    }
+    fprintf(out_timetable, "image_batch,%ld\n", clock() - start_time);
+
+    #endif
+
+    #ifdef LOOKUP_TYPED
+
+    log_printf(STATUS_REPORTS, "status", "Filling the typed table.\n");
+
+    typed_table_t typed_table = {};
+    TypedTable_ctor(&typed_table, (size_t) bucket_count, &errno);
+    _LOG_FAIL_CHECK_(TypedTable_status(&typed_table) == 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+    track_allocation(typed_table, typed_table_dtor);
+
+    typed_key_t* typed_requests = NULL;
+    alloc_status = posix_memalign((void**)&typed_requests, 32, sample_size * sizeof(*typed_requests));
+    _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+    track_allocation(typed_requests, free_variable);
+
+    //* Fixed keys only hold short words, so the typed table gets the words that fit a single record.
+    size_t typed_count = 0;
+    for (size_t offset = 0; offset < list_size; offset += word_record_size(word_list + offset, list_size - offset)) {
+        if (word_record_size(word_list + offset, list_size - offset) > MAX_WORD_LENGTH) continue;
+
+        typed_requests[typed_count] = typed_key_make(word_list + offset, list_size - offset);
+        TypedTable_insert(&typed_table, typed_requests[typed_count++], &errno);
+    }
+
+    for (size_t request_id = typed_count - 1; request_id > 0; --request_id) {
+        size_t other_id = (size_t) rand() % (request_id + 1);
+        typed_key_t request = typed_requests[request_id];
+        typed_requests[request_id] = typed_requests[other_id];
+        typed_requests[other_id] = request;
+    }
+
+    log_printf(STATUS_REPORTS, "status", "Looking the keys up in the typed table.\n");
+
+    const typed_key_t** typed_results = (const typed_key_t**) results;
 
-    fprintf(out_timetable, "test_count,time\n");
+    start_time = clock();
+    for (size_t request_id = 0; request_id < typed_count; ++request_id) {
+        typed_results[request_id] = TypedTable_find_value(&typed_table, typed_requests[request_id]);
+    }
+    fprintf(out_timetable, "typed,%ld\n", clock() - start_time);
+
+    start_time = clock();
+    for (size_t request_id = 0; request_id < typed_count; request_id += LOOKUP_BATCH_SIZE) {
+        size_t batch_size = typed_count - request_id < LOOKUP_BATCH_SIZE ? typed_count - request_id : LOOKUP_BATCH_SIZE;
+        TypedTable_find_batch(&typed_table, typed_requests + request_id, batch_size, typed_results + request_id);
+    }
+    fprintf(out_timetable, "typed_batch,%ld\n", clock() - start_time);
+
+    #endif
+
+    log_printf(STATUS_REPORTS, "status", "Testing is finished. Closing the file.\n");
+
+    if (out_timetable) fclose(out_timetable);
+
+    #endif
+
+
+    #ifdef CONCURRENT_TEST  //* CONCURRENT TEST CASE ==============================
+    log_printf(STATUS_REPORTS, "status", "Generating words for the writer.\n");
+
+    const char* new_word_list = NULL;
+    alloc_status = posix_memalign((void**)&new_word_list, 32, list_size * sizeof(*new_word_list));
+    _LOG_FAIL_CHECK_(alloc_status == 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+    generate_data((void*)new_word_list, (void*)(new_word_list + list_size));
+    track_allocation(new_word_list, free_variable);
+
+    log_printf(STATUS_REPORTS, "status", "Opening benchmark output file.\n");
+
+    FILE* out_timetable = fopen(OUTPUT_TIMETABLE_NAME, "w");
+    _LOG_FAIL_CHECK_(out_timetable, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOENT);
+
+    fprintf(out_timetable, "readers,lookups_per_second\n");
 
     log_printf(STATUS_REPORTS, "status", "Starting tests.\n");
 
-    for (unsigned test_size = MIN_TEST_COUNT; test_size < MAX_TEST_COUNT; ++test_size) {
-        clock_t start_time = clock();
+    WriterTask writer_task = { .table = &table, .hash_fn = tested_hash, .word_list = new_word_list, .list_size = list_size,
+                               .comparator = comparator, .stop = false, .offset = 0,
+                               .erasing = false, .written = 0 };
+    ReaderTask reader_tasks[MAX_READER_COUNT] = {};
 
-        for (size_t action_id = 0; action_id < test_size; ++action_id) {
-            static char word[MAX_WORD_LENGTH] __attribute__((__aligned__(32))) = "";
-            for (char* ptr = word; ptr < word + MAX_WORD_LENGTH; ++ptr) {
-                *ptr = (char) rand();
-            }
+    for (unsigned reader_count = 1; reader_count <= MAX_READER_COUNT; ++reader_count) {
+        pthread_t readers[MAX_READER_COUNT] = {};
+        pthread_t writer = {};
 
-            unsigned op_key = rand() % 100;
-            if (op_key < 50) {
-                #if OPTIMIZATION_LEVEL < 1
-                HashTable_find_value(&table, TESTED_HASH(word, word + MAX_WORD_LENGTH), word, strcmp);
-                #else
-                HashTable_find_value(&table, TESTED_HASH(word, word + MAX_WORD_LENGTH),
-                    _mm256_load_si256((const __m256i*) word), simd_comparison_placeholder);
-                #endif
-            } else {
-                #if OPTIMIZATION_LEVEL < 1
-                HashTable_insert(&table, TESTED_HASH(word, word + MAX_WORD_LENGTH), word, strcmp);
-                #else
-                HashTable_insert(&table, TESTED_HASH(word, word + MAX_WORD_LENGTH),
-                    _mm256_load_si256((const __m256i*) word), simd_comparison_placeholder);
-                #endif
+        writer_task.stop = false;
+        pthread_create(&writer, NULL, writer_routine, &writer_task);
+
+        timespec start_time = {};
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+        for (unsigned reader_id = 0; reader_id < reader_count; ++reader_id) {
+            reader_tasks[reader_id] = { .table = &table, .hashes = request_hashes, .requests = requests,
+                                        .count = request_count, .first = request_count * reader_id / reader_count,
+                                        .comparator = comparator, .found = 0 };
+            pthread_create(&readers[reader_id], NULL, reader_routine, &reader_tasks[reader_id]);
+        }
+
+        for (unsigned reader_id = 0; reader_id < reader_count; ++reader_id) pthread_join(readers[reader_id], NULL);
+
+        timespec end_time = {};
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+        __atomic_store_n(&writer_task.stop, true, __ATOMIC_RELAXED);
+        pthread_join(writer, NULL);
+
+        double duration = (double) (end_time.tv_sec - start_time.tv_sec) + (double) (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+        fprintf(out_timetable, "%u,%.0lf\n", reader_count, (double) (request_count * reader_count) / duration);
+    }
+
+    log_printf(STATUS_REPORTS, "status", "Writer has inserted or erased %lu words during the test.\n", writer_task.written);
+    log_printf(STATUS_REPORTS, "status", "Testing is finished. Closing the file.\n");
+
+    if (out_timetable) fclose(out_timetable);
+
+    #endif
+
+
+    #ifdef BUILD_TEST  //* BUILD TEST CASE ==============================
+    log_printf(STATUS_REPORTS, "status", "Opening benchmark output file.\n");
+
+    FILE* out_timetable = fopen(OUTPUT_TIMETABLE_NAME, "w");
+    _LOG_FAIL_CHECK_(out_timetable, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOENT);
+
+    #ifdef BULK_BUILD
+    fprintf(out_timetable, "threads,time,merge_time\n");
+    #else
+    fprintf(out_timetable, "threads,time\n");
+    #endif
+
+    log_printf(STATUS_REPORTS, "status", "Starting tests.\n");
+
+    //* The expected size is the number of distinct keys, counted by a table built without concurrency.
+    HashTable reference_table = {};
+    HashTable_ctor(&reference_table, (size_t) bucket_count, tested_hash, &errno);
+    _LOG_FAIL_CHECK_(HashTable_status(&reference_table) == 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+
+    for (size_t request_id = 0; request_id < request_count; ++request_id) {
+        HashTable_insert(&reference_table, request_hashes[request_id], requests[request_id], comparator, &errno);
+    }
+
+    size_t expected_size = reference_table.size;
+    HashTable_dtor(&reference_table);
+
+    for (unsigned builder_count = 1; builder_count <= MAX_BUILDER_COUNT; ++builder_count) {
+        TESTED_TABLE built_table = {};
+        TABLE_FN(ctor)(&built_table, (size_t) bucket_count, tested_hash, &errno);
+        _LOG_FAIL_CHECK_(TABLE_FN(status)(&built_table) == 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+
+        timespec start_time = {};
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+        #ifdef BULK_BUILD
+        TABLE_FN(build)(&built_table, request_hashes, requests, request_count, builder_count, comparator, &errno);
+        #else
+        pthread_t builders[MAX_BUILDER_COUNT] = {};
+        BuilderTask builder_tasks[MAX_BUILDER_COUNT] = {};
+
+        for (unsigned builder_id = 0; builder_id < builder_count; ++builder_id) {
+            builder_tasks[builder_id] = { .table = &built_table, .hashes = request_hashes, .elements = requests,
+                                          .count = request_count, .first = request_count * builder_id / builder_count,
+                                          .comparator = comparator };
+            pthread_create(&builders[builder_id], NULL, builder_routine, &builder_tasks[builder_id]);
+        }
+
+        for (unsigned builder_id = 0; builder_id < builder_count; ++builder_id) pthread_join(builders[builder_id], NULL);
+        #endif
+
+        timespec end_time = {};
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+        //* Every duplicate should be stored once regardless of the number of threads.
+        _LOG_FAIL_CHECK_(built_table.size == expected_size, "error", ERROR_REPORTS, {
+            log_printf(ERROR_REPORTS, "error", "%u threads have built a table of %lu elements instead of %lu.\n",
+                       builder_count, built_table.size, expected_size);
+        }, NULL, 0);
+
+        size_t missing_count = 0;
+        for (size_t request_id = 0; request_id < request_count; ++request_id) {
+            missing_count += TABLE_FN(find_value)(&built_table, request_hashes[request_id], requests[request_id], comparator) == NULL;
+        }
+        _LOG_FAIL_CHECK_(missing_count == 0, "error", ERROR_REPORTS, {
+            log_printf(ERROR_REPORTS, "error", "%lu keys are missing from the table built by %u threads.\n",
+                       missing_count, builder_count);
+        }, NULL, 0);
+
+        long duration = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_nsec - start_time.tv_nsec) / 1000;
+
+        #ifdef BULK_BUILD
+        HashTable merged_table = {};
+
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        TABLE_FN(merge)(&built_table, &merged_table, (size_t) bucket_count, tested_hash, builder_count, &errno);
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+        _LOG_FAIL_CHECK_(merged_table.size == expected_size, "error", ERROR_REPORTS, {
+            log_printf(ERROR_REPORTS, "error", "Merged table has %lu elements instead of %lu.\n", merged_table.size, expected_size);
+        }, NULL, 0);
+
+        if (HashTable_status(&merged_table) == 0) {
+            missing_count = 0;
+            for (size_t request_id = 0; request_id < request_count; ++request_id) {
+                missing_count += HashTable_find_value(&merged_table, request_hashes[request_id], requests[request_id], comparator) == NULL;
             }
+            _LOG_FAIL_CHECK_(missing_count == 0, "error", ERROR_REPORTS, {
+                log_printf(ERROR_REPORTS, "error", "%lu keys are missing from the merged table.\n", missing_count);
+            }, NULL, 0);
+
+            HashTable_dtor(&merged_table);
+        }
+
+        long merge_duration = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_nsec - start_time.tv_nsec) / 1000;
+        fprintf(out_timetable, "%u,%ld,%ld\n", builder_count, duration, merge_duration);
+        #else
+        fprintf(out_timetable, "%u,%ld\n", builder_count, duration);
+        #endif
+
+        TABLE_FN(dtor)(&built_table);
+    }
+
+    log_printf(STATUS_REPORTS, "status", "Testing is finished. Closing the file.\n");
+
+    if (out_timetable) fclose(out_timetable);
+
+    #endif
+
+
+    #ifdef PERFORMANCE_TEST  //* PERFORMANCE TEST CASE ==============================
+    log_printf(STATUS_REPORTS, "status", "Opening benchmark output file.\n");
+
+    FILE* out_timetable = fopen(OUTPUT_TIMETABLE_NAME, "w");
+    _LOG_FAIL_CHECK_(out_timetable, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOENT);
+
+    long* times = (long*) calloc(tested_hash_count * (MAX_TEST_COUNT - MIN_TEST_COUNT) + 1, sizeof(*times));
+    track_allocation(times, free_variable);
+    _LOG_FAIL_CHECK_(times, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
+
+    log_printf(STATUS_REPORTS, "status", "Starting tests.\n");
+
+    for (size_t hash_id = 0; hash_id < tested_hash_count; ++hash_id) {
+        //* Every function gets an empty table and the same sequence of operations.
+        if (hash_id > 0) {
+            reset_table(&table, (size_t) bucket_count, tested_hashes[hash_id]->function);
+            _LOG_FAIL_CHECK_(TABLE_FN(status)(&table) == 0, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOMEM);
         }
+        srand(1);
 
-        fprintf(out_timetable, "%u,%ld\n", test_size, clock() - start_time);
+        log_printf(STATUS_REPORTS, "status", "Testing %s.\n", tested_hashes[hash_id]->name);
+        run_performance_test(tested_hashes[hash_id], &table, comparator, times + hash_id * (MAX_TEST_COUNT - MIN_TEST_COUNT));
+    }
+
+    log_printf(STATUS_REPORTS, "status", "Writing results to the file.\n");
+
+    if (tested_hash_count == 1) {
+        fprintf(out_timetable, "test_count,time\n");
+    } else {
+        fprintf(out_timetable, "test_count");
+        for (size_t hash_id = 0; hash_id < tested_hash_count; ++hash_id) fprintf(out_timetable, ",%s", tested_hashes[hash_id]->name);
+        fprintf(out_timetable, "\n");
+    }
+
+    for (unsigned test_size = MIN_TEST_COUNT; test_size < MAX_TEST_COUNT; ++test_size) {
+        fprintf(out_timetable, "%u", test_size);
+        for (size_t hash_id = 0; hash_id < tested_hash_count; ++hash_id) {
+            fprintf(out_timetable, ",%ld", times[hash_id * (MAX_TEST_COUNT - MIN_TEST_COUNT) + test_size - MIN_TEST_COUNT]);
+        }
+        fprintf(out_timetable, "\n");
     }
 
     log_printf(STATUS_REPORTS, "status", "Testing is finished. Closing the file.\n");
@@ -154,5 +1005,42 @@ int main(const int argc, const char** argv) {
 
     #endif
 
+    #ifdef QUALITY_TEST  //* QUALITY TEST CASE ==============================
+
+    //* The suite hashes raw bytes and does not use the table.
+    SILENCE_UNUSED(comparator);
+
+    //* Without -F the suite covers the whole registry.
+    if (*hash_name == '\0') {
+        for (size_t hash_id = 0; hash_id < HASH_FUNCTION_COUNT; ++hash_id) tested_hashes[hash_id] = &HASH_FUNCTIONS[hash_id];
+        tested_hash_count = HASH_FUNCTION_COUNT;
+    }
+
+    log_printf(STATUS_REPORTS, "status", "Opening quality report file.\n");
+
+    FILE* out_quality = fopen(OUTPUT_QUALITY_NAME, "w");
+    _LOG_FAIL_CHECK_(out_quality, "error", ERROR_REPORTS, return_clean(EXIT_FAILURE), NULL, ENOENT);
+
+    HashQuality_print_header(out_quality);
+
+    for (size_t hash_id = 0; hash_id < tested_hash_count; ++hash_id) {
+        log_printf(STATUS_REPORTS, "status", "Testing quality of %s.\n", tested_hashes[hash_id]->name);
+
+        HashQualityReport report = {};
+        run_quality_test(tested_hashes[hash_id], &report);
+        HashQuality_print(out_quality, tested_hashes[hash_id]->name, &report);
+    }
+
+    log_printf(STATUS_REPORTS, "status", "Testing is finished. Closing the file.\n");
+
+    if (out_quality) fclose(out_quality);
+
+    #endif
+
+    #ifdef BLOOM_FILTER
+    log_printf(STATUS_REPORTS, "status", "Lookup filter takes %lu bytes, its estimated false positive rate is %lf.\n",
+               BloomFilter_footprint(&table.filter), BloomFilter_false_positive_rate(&table.filter));
+    #endif
+
     return_clean(errno == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
 }
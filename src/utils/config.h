@@ -18,13 +18,27 @@ static const int NUMBER_OF_OWLS = 10;
 
 static const char OUTPUT_TABLE_NAME[] = "output.csv";
 static const char OUTPUT_TIMETABLE_NAME[] = "bmark.csv";
+static const char OUTPUT_IMAGE_NAME[] = "table.img";
+static const char OUTPUT_QUALITY_NAME[] = "quality.csv";
+static const char OUTPUT_PROBE_NAME[] = "probe.csv";
 
 static const unsigned MAX_WORD_LENGTH = 32;
 
+//* Size of the buffer of the hash function name given with -F.
+static const size_t MAX_HASH_NAME_LENGTH = 64;
+
+//* Words are stored in MAX_WORD_LENGTH-byte records, longer words take several records and end with a null character.
+//* GEN_LONG_STRING makes the generator mix in words up to this length.
+static const unsigned MAX_LONG_WORD_LENGTH = 256;
+
 #ifndef OPTIMIZATION_LEVEL
 #define OPTIMIZATION_LEVEL 0
 #endif
 
+#ifndef TESTED_TABLE
+#define TESTED_TABLE HashTable
+#endif
+
 #ifndef GEN_INT
 #ifndef GEN_DOUBLE
     #define GEN_STRING
@@ -47,7 +61,36 @@ static const unsigned MAX_WORD_LENGTH = 32;
     static const unsigned BUCKET_COUNT = 1000;
 #endif
 
+#ifndef HT_MAX_LOAD_FACTOR
+    #ifdef DISTRIBUTION_TEST
+    //* Distribution test reads sizes of the buckets, so the bucket count has to stay fixed.
+    static const unsigned HT_MAX_LOAD_FACTOR = 0;
+    #else
+    static const unsigned HT_MAX_LOAD_FACTOR = 4;
+    #endif
+#endif
+
 #ifndef TEST_COUNT
     static const unsigned TEST_COUNT = 100000;
 #endif
+
+#ifndef FILTER_EXPECTED_COUNT
+    //* Number of keys the lookup filter of the table is sized for (enabled by BLOOM_FILTER).
+    static const size_t FILTER_EXPECTED_COUNT = TEST_COUNT;
+#endif
+
+#ifndef MAX_READER_COUNT
+    //* Concurrent test measures lookup throughput for every number of reader threads up to this one.
+    static const unsigned MAX_READER_COUNT = 8;
+#endif
+
+#ifndef MAX_BUILDER_COUNT
+    //* Build test measures construction time of the table for every number of threads up to this one.
+    static const unsigned MAX_BUILDER_COUNT = 8;
+#endif
+
+#ifndef LOOKUP_BATCH_SIZE
+    //* Number of keys passed to a single batched lookup call of the lookup test.
+    static const size_t LOOKUP_BATCH_SIZE = 256;
+#endif
 #endif
\ No newline at end of file
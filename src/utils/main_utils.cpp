@@ -15,16 +15,33 @@ void print_label() {
     log_printf(ABSOLUTE_IMPORTANCE, "build info", "Build from %s %s.\n", __DATE__, __TIME__);
 }
 
-static void fill_segment(void* data);
+static size_t fill_segment(void* data, size_t space);
 
 void generate_data(void* begin, void* end) {
-    for (char* segment = (char*)begin; segment < end; segment += MAX_WORD_LENGTH) {
-        memset(segment, 0, MAX_WORD_LENGTH);
-        fill_segment((void*) segment);
+    for (char* segment = (char*)begin; segment < end;) {
+        segment += fill_segment((void*) segment, (size_t) ((char*) end - segment));
     }
 }
 
-static void fill_segment(void* data) {
+size_t word_record_size(const char* word, size_t space) {
+    return (strnlen(word, space) / MAX_WORD_LENGTH + 1) * MAX_WORD_LENGTH;
+}
+
+size_t word_key_length(const char* word, size_t space) {
+    #if defined(GEN_INT)
+    SILENCE_UNUSED(word); SILENCE_UNUSED(space);
+    return sizeof(unsigned);
+    #elif defined(GEN_DOUBLE)
+    SILENCE_UNUSED(word); SILENCE_UNUSED(space);
+    return sizeof(double);
+    #else
+    return strnlen(word, space);
+    #endif
+}
+
+static size_t fill_segment(void* data, size_t space) {
+    memset(data, 0, MAX_WORD_LENGTH);
+
     #ifdef GEN_INT
         *(unsigned*) data = rand();
     #endif
@@ -39,8 +56,23 @@ static void fill_segment(void* data) {
         unsigned length = 0;
         for (int throw_id = 0; throw_id < MAX_WORD_LENGTH; ++throw_id) length += rand() & 1;
 
+        #ifdef GEN_LONG_STRING
+        //* Every eighth word is long, but only if its record fits the remaining space.
+        if (rand() % 8 == 0) length += rand() % (MAX_LONG_WORD_LENGTH - MAX_WORD_LENGTH + 1);
+        if ((length / MAX_WORD_LENGTH + 1) * MAX_WORD_LENGTH > space) length %= MAX_WORD_LENGTH;
+        memset(data, 0, (length / MAX_WORD_LENGTH + 1) * MAX_WORD_LENGTH);
+        #else
+        //* The word has to end with a null character to fit a single record.
+        if (length == MAX_WORD_LENGTH) --length;
+        #endif
+
         for (unsigned id = 0; id < length; ++id) {
             ((char*) data)[id] = (char)(97 + rand() % (122 - 97));
         }
+
+        return word_record_size((const char*) data, space);
     #endif
+
+    SILENCE_UNUSED(space);
+    return MAX_WORD_LENGTH;
 }
@@ -31,4 +31,22 @@ void print_label();
  */
 void generate_data(void* begin, void* end);
 
+/**
+ * @brief Get the number of bytes the word takes in the word list (the word and its null character padded to MAX_WORD_LENGTH)
+ * 
+ * @param word
+ * @param space number of bytes left in the word list
+ * @return size_t
+ */
+size_t word_record_size(const char* word, size_t space);
+
+/**
+ * @brief Get the length of the key the word record holds (generated numbers are binary and may contain zero bytes)
+ * 
+ * @param word
+ * @param space number of bytes left in the word list
+ * @return size_t
+ */
+size_t word_key_length(const char* word, size_t space);
+
 #endif
\ No newline at end of file